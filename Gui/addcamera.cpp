@@ -154,7 +154,7 @@ void AddCamera::recording()
         QCoreApplication::processEvents();
 
         m_videoCaptureTemp >> m_frame;
-        m_mask = CaptureCamera::myColorThreshold(m_frame, 220, 255);
+        CaptureCamera::myColorThreshold(m_frame, m_mask, 220, 255);
 
         for(int i = 0; i < m_frame.rows; i++)
         {
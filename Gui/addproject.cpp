@@ -28,6 +28,9 @@
 #include <QMenuBar>
 
 #include <QMessageBox>
+#include <QtConcurrent/QtConcurrent>
+
+#include <algorithm>
 
 using glm::vec2;
 using glm::vec3;
@@ -46,6 +49,8 @@ AddProject::AddProject(QWidget *parent) :
 
 Room *AddProject::resolveProject()
 {
+    waitForCalibration();
+
     newProject = new Room(nullptr, vec3(ui->width->text().toInt(), ui->length->text().toInt(), ui->height->text().toInt() ),
                         ui->epsilon->text().toFloat(), ui->name->text());
 
@@ -59,6 +64,8 @@ Room *AddProject::resolveProject()
 
 AddProject::~AddProject()
 {
+    waitForCalibration();
+
     delete ui;
 }
 
@@ -167,6 +174,8 @@ void AddProject::on_deleteCamera_pressed()
 
     if(selection->hasSelection())
     {
+        waitForCalibration();
+
         QModelIndexList indexes = selection->selectedRows();
 
         size_t index;
@@ -178,6 +187,23 @@ void AddProject::on_deleteCamera_pressed()
             newCameras[index]->Hide();
             newCameras[index]->TurnOff();
             newCameras.erase(newCameras.begin()+index);
+
+            //threshold of deleted camera is not reported, watchers of others keep their indexes
+            if(index < calibrationWatchers.size())
+            {
+                if(calibrationWatchers[index])
+                {
+                    delete calibrationWatchers[index];
+                    --runningCalibrations;
+                }
+
+                calibrationWatchers.erase(calibrationWatchers.begin()+index);
+            }
+        }
+
+        if(runningCalibrations == 0)
+        {
+            ui->CalibWithMarkers->setEnabled(true);
         }
     }
 }
@@ -220,13 +246,67 @@ void AddProject::on_CalibWithMarkers_clicked()
     ui->TextWithMarkers->setText(QString::fromStdString(""));
     int numOfMarkers = ui->numLEDs->text().toInt();
 
+    if(newCameras.empty())
+    {
+        calibMarkers = true;
+        return;
+    }
+
+    //cameras are independent, all of them are calibrated at once while dialog stays responsive
+    ui->CalibWithMarkers->setEnabled(false);
+    ui->progressBar->setValue(0);
+
+    calibrationWatchers.assign(newCameras.size(), nullptr);
+    runningCalibrations = newCameras.size();
+
     for(size_t i = 0; i < newCameras.size(); i++)
     {
-        ui->TextWithMarkers->append(newCameras[i]->getName() + ": ");
-        ui->TextWithMarkers->append(QString::number(newCameras[i]->CalibWithMarkers(numOfMarkers)));
+        calibrationWatchers[i] = new QFutureWatcher<int>(this);
+        connect(calibrationWatchers[i], SIGNAL(finished()), this, SLOT(calibrationFinished()));
+
+        calibrationWatchers[i]->setFuture(QtConcurrent::run(newCameras[i], &CaptureCamera::CalibWithMarkers, numOfMarkers));
+    }
+}
+
+void AddProject::calibrationFinished()
+{
+    QFutureWatcher<int> *watcher = static_cast<QFutureWatcher<int>*>(sender());
+    size_t i = std::find(calibrationWatchers.begin(), calibrationWatchers.end(), watcher) - calibrationWatchers.begin();
+
+    if(i == calibrationWatchers.size())
+    {
+        return;
     }
 
-    calibMarkers = true;
+    int threshold = watcher->result();
+
+    newCameras[i]->getWidget()->setThreshold(threshold);
+
+    ui->TextWithMarkers->append(newCameras[i]->getName() + ": ");
+    ui->TextWithMarkers->append(QString::number(threshold));
+
+    calibrationWatchers[i] = nullptr;
+    watcher->deleteLater();
+
+    --runningCalibrations;
+    ui->progressBar->setValue((100*(newCameras.size() - runningCalibrations))/newCameras.size());
+
+    if(runningCalibrations == 0)
+    {
+        calibMarkers = true;
+        ui->CalibWithMarkers->setEnabled(true);
+    }
+}
+
+void AddProject::waitForCalibration()
+{
+    for(size_t i = 0; i < calibrationWatchers.size(); i++)
+    {
+        if(calibrationWatchers[i])
+        {
+            calibrationWatchers[i]->waitForFinished();
+        }
+    }
 }
 
 void AddProject::on_editCamera_clicked()
@@ -24,6 +24,7 @@
 #define ADDPROJECT_H
 
 #include <QtWidgets/QDialog>
+#include <QFutureWatcher>
 
 #include "../room.h"
 #include "addcamera.h"
@@ -41,6 +42,10 @@ class AddProject : public QDialog
 
     bool calibNoMarkers, calibMarkers;
 
+    //marker calibration runs in thread pool, watcher of camera i sets its threshold when done
+    std::vector<QFutureWatcher<int>*> calibrationWatchers;
+    size_t runningCalibrations = 0;
+
 public:
     explicit AddProject(QWidget *parent = 0);
 
@@ -69,7 +74,12 @@ private slots:
 
     void on_editCamera_clicked();
 
+    void calibrationFinished();
+
 private:
+    /// cameras are not touched by calibration afterwards
+    void waitForCalibration();
+
 
     void addCamToTable(CaptureCamera *temp);
     Ui::AddProject *ui;
@@ -23,13 +23,33 @@
 #include "camwidget.h"
 #include "ui_camwidget.h"
 
+#include <cstring>
 #include <iostream>
 #include <QDir>
 
+#ifndef GL_BGR
+#define GL_BGR 0x80E0
+#endif
+
+#ifndef GL_CLAMP_TO_EDGE
+#define GL_CLAMP_TO_EDGE 0x812F
+#endif
+
+#ifndef GL_UNPACK_ROW_LENGTH
+#define GL_UNPACK_ROW_LENGTH 0x0CF2
+#endif
+
 CQtOpenCVViewerGl::CQtOpenCVViewerGl(QWidget *parent) :
-    QGLWidget(parent)
+    QGLWidget(parent),
+    mPixelBuffer(QOpenGLBuffer::PixelUnpackBuffer)
 {
-    mSceneChanged = false;
+    mPending = false;
+    mUploadChanged = false;
+
+    mTexture = 0;
+    mTextureW = 0;
+    mTextureH = 0;
+    mTextureChannels = 0;
 
     mOutH = 0;
     mOutW = 0;
@@ -37,15 +57,107 @@ CQtOpenCVViewerGl::CQtOpenCVViewerGl(QWidget *parent) :
 
     mPosX = 0;
     mPosY = 0;
+
+    mDisplayRate = 0;
+    connect(&mDisplayTimer, SIGNAL(timeout()), this, SLOT(displayFrame()));
+    setDisplayRate(30);
 }
 
-void CQtOpenCVViewerGl::initializeGL()
+CQtOpenCVViewerGl::~CQtOpenCVViewerGl()
+{
+    makeCurrent();
+
+    if(mTexture)
+    {
+        glDeleteTextures(1, &mTexture);
+    }
+
+    if(mPixelBuffer.isCreated())
+    {
+        mPixelBuffer.destroy();
+    }
+}
+
+void CQtOpenCVViewerGl::setDisplayRate(int fps)
+{
+    mDisplayRate = fps > 0 ? fps : 30;
+    mDisplayTimer.start(1000 / mDisplayRate);
+}
+
+void CQtOpenCVViewerGl::submitFrame(const cv::Mat &image)
 {
-    mSceneChanged = true;
+    if(image.empty() || (image.channels() != 3 && image.channels() != 1) || image.depth() != CV_8U)
+    {
+        return;
+    }
+
+    QMutexLocker l(&mFrameMutex);
+
+    //previous frame was not displayed yet, this one would be overwritten anyway
+    if(mPending)
+    {
+        return;
+    }
 
-    showImage(cv::Mat::zeros(480, 640, 16));
+    //buffer is reused, allocation happens only when resolution changes
+    image.copyTo(mPendingImage);
+    mPending = true;
+}
 
-    updateScene();
+void CQtOpenCVViewerGl::showImage( cv::Mat image )
+{
+    submitFrame(image);
+}
+
+void CQtOpenCVViewerGl::displayFrame()
+{
+    //hidden preview keeps old frame pending, so capture threads do not copy at all
+    if(!isVisible())
+    {
+        return;
+    }
+
+    {
+        QMutexLocker l(&mFrameMutex);
+
+        if(!mPending)
+        {
+            return;
+        }
+
+        cv::swap(mPendingImage, mUploadImage);
+        mPending = false;
+    }
+
+    float ratio = (float)mUploadImage.cols/(float)mUploadImage.rows;
+
+    if(ratio != mImgRatio)
+    {
+        mImgRatio = ratio;
+        resizeGL(width(), height());
+    }
+
+    mUploadChanged = true;
+
+    updateGL();
+}
+
+void CQtOpenCVViewerGl::initializeGL()
+{
+    glGenTextures(1, &mTexture);
+    glBindTexture(GL_TEXTURE_2D, mTexture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    //without PBO support texture is uploaded straight from memory
+    if(mPixelBuffer.create())
+    {
+        mPixelBuffer.setUsagePattern(QOpenGLBuffer::StreamDraw);
+    }
+
+    submitFrame(cv::Mat::zeros(480, 640, CV_8UC3));
 }
 
 void CQtOpenCVViewerGl::resizeGL(int width, int height)
@@ -75,108 +187,89 @@ void CQtOpenCVViewerGl::resizeGL(int width, int height)
 
     mPosX = (width-mOutW)/2;
     mPosY = (height-mOutH)/2;
-
-    mSceneChanged = true;
-
-    updateScene();
-}
-
-void CQtOpenCVViewerGl::updateScene()
-{
-    if( mSceneChanged && this->isVisible() )
-    {
-        updateGL();
-    }
 }
 
-void CQtOpenCVViewerGl::paintGL()
+void CQtOpenCVViewerGl::uploadTexture()
 {
-    makeCurrent();
+    const cv::Mat &image = mUploadImage;
+    const int channels = image.channels();
+    const GLenum format = channels == 3 ? GL_BGR : GL_LUMINANCE;
+    const size_t bytes = image.step * image.rows;
 
-    qglClearColor(Qt::white);
-    glClear(GL_COLOR_BUFFER_BIT);
+    glBindTexture(GL_TEXTURE_2D, mTexture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, image.step / image.elemSize());
 
-    if(mSceneChanged)
-        renderImage();
+    //storage is allocated only when resolution changes, then only texels are replaced
+    if(image.cols != mTextureW || image.rows != mTextureH || channels != mTextureChannels)
+    {
+        glTexImage2D(GL_TEXTURE_2D, 0, channels == 3 ? GL_RGB8 : GL_LUMINANCE8, image.cols, image.rows, 0, format, GL_UNSIGNED_BYTE, nullptr);
 
-    mSceneChanged = false;
-}
+        mTextureW = image.cols;
+        mTextureH = image.rows;
+        mTextureChannels = channels;
+    }
 
-void CQtOpenCVViewerGl::renderImage()
-{
-    makeCurrent();
+    void *mapped = nullptr;
 
-    if (!mRenderQtImg.isNull())
+    if(mPixelBuffer.isCreated() && mPixelBuffer.bind())
     {
-        glLoadIdentity();
+        //orphaning old storage lets driver continue with previous transfer
+        mPixelBuffer.allocate(bytes);
+        mapped = mPixelBuffer.map(QOpenGLBuffer::WriteOnly);
 
-        QImage image; // the image rendered
-
-        glPushMatrix();
+        if(mapped)
         {
-            int imW = mRenderQtImg.width();
-            int imH = mRenderQtImg.height();
-
-            // The image is to be resized to fit the widget?
-            if( imW != this->size().width() &&
-                    imH != this->size().height() )
-            {
-
-                image = mRenderQtImg.scaled( //this->size(),
-                                             QSize(mOutW,mOutH),
-                                             Qt::IgnoreAspectRatio,
-                                             Qt::SmoothTransformation
-                                             );
-
-                //qDebug( QString( "Image size: (%1x%2)").arg(imW).arg(imH).toAscii() );
-            }
-            else
-                image = mRenderQtImg;
-
-            // ---> Centering image in draw area
-
-            glRasterPos2i( mPosX, mPosY );
-            // <--- Centering image in draw area
+            memcpy(mapped, image.data, bytes);
+            mPixelBuffer.unmap();
 
-            image = image.mirrored(true,false);
-
-            imW = image.width();
-            imH = image.height();
-
-            glDrawPixels( imW, imH, GL_RGBA, GL_UNSIGNED_BYTE, image.bits());
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, image.cols, image.rows, format, GL_UNSIGNED_BYTE, nullptr);
         }
-        glPopMatrix();
 
-        // end
-        glFlush();
+        mPixelBuffer.release();
+    }
+
+    if(!mapped)
+    {
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, image.cols, image.rows, format, GL_UNSIGNED_BYTE, image.data);
     }
+
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
 }
 
-void CQtOpenCVViewerGl::showImage( cv::Mat image )
+void CQtOpenCVViewerGl::paintGL()
 {
+    makeCurrent();
 
-    image.copyTo(mOrigImage);
+    qglClearColor(Qt::white);
+    glClear(GL_COLOR_BUFFER_BIT);
 
-    mImgRatio = (float)image.cols/(float)image.rows;
+    if(mUploadChanged && !mUploadImage.empty())
+    {
+        uploadTexture();
+        mUploadChanged = false;
+    }
 
-    if( mOrigImage.channels() == 3)
-        mRenderQtImg = QImage((const unsigned char*)(mOrigImage.data),
-                              mOrigImage.cols, mOrigImage.rows,
-                              mOrigImage.step, QImage::Format_RGB888).rgbSwapped();
-    else if( mOrigImage.channels() == 1)
-        mRenderQtImg = QImage((const unsigned char*)(mOrigImage.data),
-                              mOrigImage.cols, mOrigImage.rows,
-                              mOrigImage.step, QImage::Format_Indexed8);
-    else
+    if(!mTextureW)
+    {
         return;
+    }
 
-    mRenderQtImg = QGLWidget::convertToGLFormat(mRenderQtImg);
+    glLoadIdentity();
 
-    mSceneChanged = true;
+    glEnable(GL_TEXTURE_2D);
+    glBindTexture(GL_TEXTURE_2D, mTexture);
+    glColor3f(1.0f, 1.0f, 1.0f);
 
-    updateScene();
+    //GPU scales the image, texture coordinates flip it vertically and mirror it like before
+    glBegin(GL_QUADS);
+        glTexCoord2f(1.0f, 1.0f); glVertex2i(mPosX, mPosY);
+        glTexCoord2f(0.0f, 1.0f); glVertex2i(mPosX + mOutW, mPosY);
+        glTexCoord2f(0.0f, 0.0f); glVertex2i(mPosX + mOutW, mPosY + mOutH);
+        glTexCoord2f(1.0f, 0.0f); glVertex2i(mPosX, mPosY + mOutH);
+    glEnd();
 
-    return;
+    glDisable(GL_TEXTURE_2D);
 }
 
 CamWidget::CamWidget(QWidget *parent) :
@@ -25,14 +25,30 @@
 
 #include <QWidget>
 #include <QImage>
+#include <QMutex>
+#include <QTimer>
+#include <QOpenGLBuffer>
 #include <QtOpenGL/QGLWidget>
 #include <opencv2/core/core.hpp>
 
+/**
+ * @brief preview of camera frames streamed into one texture, scaled and mirrored by GPU
+ *
+ * Capture threads hand frames over with submitFrame, frame is copied only when previous one was displayed.
+ * Timer in GUI thread uploads the latest frame at display rate, independent of capture rate.
+ */
 class CQtOpenCVViewerGl : public QGLWidget
 {
     Q_OBJECT
 public:
     explicit CQtOpenCVViewerGl(QWidget *parent = 0);
+    ~CQtOpenCVViewerGl();
+
+    /// thread safe, frames arriving faster than display rate are skipped without copy
+    void        submitFrame(const cv::Mat &image);
+
+    void        setDisplayRate(int fps);
+    int         displayRate() const {return mDisplayRate;}
 
 signals:
     void        imageSizeChanged( int outW, int outH ); /// Used to resize the image outside the widget
@@ -45,16 +61,26 @@ protected:
     void        paintGL(); /// OpenGL Rendering
     void        resizeGL(int width, int height);        /// Widget Resize Event
 
-    void        updateScene();
-    void        renderImage();
+    void        uploadTexture();
+
+private slots:
+    void        displayFrame();
 
 private:
-    bool        mSceneChanged;          /// Indicates when OpenGL view is to be redrawn
+    QMutex      mFrameMutex;
+    cv::Mat     mPendingImage;          /// written by capture thread
+    bool        mPending;
+    cv::Mat     mUploadImage;           /// owned by GUI thread
+    bool        mUploadChanged;
 
-    QImage      mRenderQtImg;           /// Qt image to be rendered
-    cv::Mat     mOrigImage;             /// original OpenCV image to be shown
+    QTimer      mDisplayTimer;
+    int         mDisplayRate;           /// frames per second
 
-    QColor      mBgColor;		/// Background color
+    GLuint      mTexture;
+    int         mTextureW;
+    int         mTextureH;
+    int         mTextureChannels;
+    QOpenGLBuffer mPixelBuffer;         /// PBO for asynchronous upload, if supported
 
     int         mOutH;                  /// Resized Image height
     int         mOutW;                  /// Resized Image width
@@ -62,9 +88,6 @@ private:
 
     int         mPosX;                  /// Top left X position to render image in the center of widget
     int         mPosY;                  /// Top left Y position to render image in the center of widget
-
-    cv::Mat m;
-
 };
 
 
@@ -0,0 +1,118 @@
+/*
+ *
+ * Copyright (C) 2014  Miroslav Krajicek, Faculty of Informatics Masaryk University (https://github.com/kaajo).
+ * All Rights Reserved.
+ *
+ * This file is part of WebCamCap.
+ *
+ * WebCamCap is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU LGPL version 3 as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WebCamCap is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU LGPL version 3
+ * along with WebCamCap. If not, see <http://www.gnu.org/licenses/lgpl-3.0.txt>.
+ *
+ */
+
+
+#include "allocationcounter.h"
+
+#if defined(WEBCAMCAP_COUNT_ALLOCATIONS) && defined(__GLIBC__)
+
+#include <cerrno>
+
+//allocator of glibc, definitions below interpose the public names for every library of the process
+extern "C"
+{
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *pointer, size_t size);
+void *__libc_memalign(size_t alignment, size_t size);
+}
+
+//no constructor may run inside malloc, so not thread_local
+static __thread size_t threadAllocations = 0;
+
+extern "C"
+{
+
+void *malloc(size_t size)
+{
+    ++threadAllocations;
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size)
+{
+    ++threadAllocations;
+    return __libc_calloc(count, size);
+}
+
+void *realloc(void *pointer, size_t size)
+{
+    ++threadAllocations;
+    return __libc_realloc(pointer, size);
+}
+
+void *memalign(size_t alignment, size_t size)
+{
+    ++threadAllocations;
+    return __libc_memalign(alignment, size);
+}
+
+void *aligned_alloc(size_t alignment, size_t size)
+{
+    ++threadAllocations;
+    return __libc_memalign(alignment, size);
+}
+
+int posix_memalign(void **pointer, size_t alignment, size_t size)
+{
+    if(alignment % sizeof(void*) != 0 || (alignment & (alignment - 1)) != 0)
+    {
+        return EINVAL;
+    }
+
+    ++threadAllocations;
+    void *memory = __libc_memalign(alignment, size);
+
+    if(!memory)
+    {
+        return ENOMEM;
+    }
+
+    *pointer = memory;
+    return 0;
+}
+
+}
+
+bool AllocationCounter::enabled()
+{
+    return true;
+}
+
+size_t AllocationCounter::count()
+{
+    return threadAllocations;
+}
+
+#else
+
+bool AllocationCounter::enabled()
+{
+    return false;
+}
+
+size_t AllocationCounter::count()
+{
+    return 0;
+}
+
+#endif
@@ -0,0 +1,45 @@
+/*
+ *
+ * Copyright (C) 2014  Miroslav Krajicek, Faculty of Informatics Masaryk University (https://github.com/kaajo).
+ * All Rights Reserved.
+ *
+ * This file is part of WebCamCap.
+ *
+ * WebCamCap is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU LGPL version 3 as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WebCamCap is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU LGPL version 3
+ * along with WebCamCap. If not, see <http://www.gnu.org/licenses/lgpl-3.0.txt>.
+ *
+ */
+
+
+#ifndef ALLOCATIONCOUNTER_H
+#define ALLOCATIONCOUNTER_H
+
+#include <cstddef>
+
+/**
+ * @brief heap allocations of the calling thread
+ *
+ * Build with WEBCAMCAP_COUNT_ALLOCATIONS (glibc only) replaces malloc, calloc, realloc and aligned allocations
+ * of the whole process, operator new and cv::fastMalloc allocate through them, so allocations inside OpenCV
+ * and Qt are counted too. Counter is plain thread local, nothing is locked. Other builds count nothing.
+ */
+class AllocationCounter
+{
+public:
+    static bool enabled();
+
+    /// allocations made by calling thread since it started
+    static size_t count();
+};
+
+#endif // ALLOCATIONCOUNTER_H
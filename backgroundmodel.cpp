@@ -0,0 +1,191 @@
+/*
+ *
+ * Copyright (C) 2014  Miroslav Krajicek, Faculty of Informatics Masaryk University (https://github.com/kaajo).
+ * All Rights Reserved.
+ *
+ * This file is part of WebCamCap.
+ *
+ * WebCamCap is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU LGPL version 3 as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WebCamCap is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU LGPL version 3
+ * along with WebCamCap. If not, see <http://www.gnu.org/licenses/lgpl-3.0.txt>.
+ *
+ */
+
+#include "backgroundmodel.h"
+
+#include <algorithm>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+//fixed point of running average, 8 bit value * 128 fits signed 16 bit
+static const int averageShift = 7;
+
+static void maxRow(uchar *background, const uchar *frame, int length)
+{
+    int i = 0;
+
+#ifdef __SSE2__
+    for(; i + 16 <= length; i += 16)
+    {
+        __m128i b = _mm_loadu_si128((const __m128i*) (background + i));
+        __m128i f = _mm_loadu_si128((const __m128i*) (frame + i));
+
+        _mm_storeu_si128((__m128i*) (background + i), _mm_max_epu8(b, f));
+    }
+#endif
+
+    for(; i < length; i++)
+    {
+        background[i] = std::max(background[i], frame[i]);
+    }
+}
+
+//average += (frame - average) / 2^shift, background is rounded average
+static void averageRow(short *average, uchar *background, const uchar *frame, int length, int shift)
+{
+    int i = 0;
+
+#ifdef __SSE2__
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i half = _mm_set1_epi16(1 << (averageShift - 1));
+    const __m128i count = _mm_cvtsi32_si128(shift);
+
+    for(; i + 16 <= length; i += 16)
+    {
+        __m128i f = _mm_loadu_si128((const __m128i*) (frame + i));
+        __m128i fLo = _mm_slli_epi16(_mm_unpacklo_epi8(f, zero), averageShift);
+        __m128i fHi = _mm_slli_epi16(_mm_unpackhi_epi8(f, zero), averageShift);
+
+        __m128i aLo = _mm_loadu_si128((const __m128i*) (average + i));
+        __m128i aHi = _mm_loadu_si128((const __m128i*) (average + i + 8));
+
+        aLo = _mm_add_epi16(aLo, _mm_sra_epi16(_mm_sub_epi16(fLo, aLo), count));
+        aHi = _mm_add_epi16(aHi, _mm_sra_epi16(_mm_sub_epi16(fHi, aHi), count));
+
+        _mm_storeu_si128((__m128i*) (average + i), aLo);
+        _mm_storeu_si128((__m128i*) (average + i + 8), aHi);
+
+        __m128i bLo = _mm_srai_epi16(_mm_add_epi16(aLo, half), averageShift);
+        __m128i bHi = _mm_srai_epi16(_mm_add_epi16(aHi, half), averageShift);
+
+        _mm_storeu_si128((__m128i*) (background + i), _mm_packus_epi16(bLo, bHi));
+    }
+#endif
+
+    for(; i < length; i++)
+    {
+        average[i] += ((frame[i] << averageShift) - average[i]) >> shift;
+        background[i] = (average[i] + (1 << (averageShift - 1))) >> averageShift;
+    }
+}
+
+BackgroundModel::BackgroundModel(BackgroundMode mode, int driftShift)
+{
+    m_mode = mode;
+    m_driftShift = driftShift;
+}
+
+void BackgroundModel::reset()
+{
+    m_frames = 0;
+    m_averageValid = false;
+}
+
+void BackgroundModel::add(const cv::Mat &frame)
+{
+    CV_Assert(frame.type() == CV_8UC3);
+
+    if(m_frames == 0 || m_background.size() != frame.size())
+    {
+        frame.copyTo(m_background);
+        frame.convertTo(m_average, CV_16S, 1 << averageShift);
+        m_averageValid = true;
+        m_frames = 1;
+        return;
+    }
+
+    ++m_frames;
+
+    const int length = frame.cols * frame.channels();
+
+    if(m_mode == BackgroundMode::MAX)
+    {
+        for(int y = 0; y < frame.rows; y++)
+        {
+            maxRow(m_background.ptr<uchar>(y), frame.ptr<uchar>(y), length);
+        }
+
+        m_averageValid = false;
+        return;
+    }
+
+    //weight 1/2^shift close to 1/n approximates mean of calibration frames
+    int shift = 0;
+
+    while((2u << shift) <= m_frames && shift < averageShift)
+    {
+        ++shift;
+    }
+
+    for(int y = 0; y < frame.rows; y++)
+    {
+        averageRow(m_average.ptr<short>(y), m_background.ptr<uchar>(y), frame.ptr<uchar>(y), length, shift);
+    }
+}
+
+void BackgroundModel::refresh(const cv::Mat &frame, const std::vector<cv::Rect> &foreground)
+{
+    if(m_frames == 0 || frame.size() != m_background.size() || frame.type() != CV_8UC3)
+    {
+        return;
+    }
+
+    if(!m_averageValid)
+    {
+        m_background.convertTo(m_average, CV_16S, 1 << averageShift);
+        m_averageValid = true;
+    }
+
+    cv::Rect frameRect(0, 0, frame.cols, frame.rows);
+
+    m_savedBackground.resize(foreground.size());
+    m_savedAverage.resize(foreground.size());
+
+    //markers are few and small, whole rows are updated and their rectangles restored afterwards
+    for(size_t i = 0; i < foreground.size(); i++)
+    {
+        cv::Rect rect = foreground[i] & frameRect;
+
+        m_background(rect).copyTo(m_savedBackground[i]);
+        m_average(rect).copyTo(m_savedAverage[i]);
+    }
+
+    const int length = frame.cols * frame.channels();
+
+    for(int y = 0; y < frame.rows; y++)
+    {
+        averageRow(m_average.ptr<short>(y), m_background.ptr<uchar>(y), frame.ptr<uchar>(y), length, m_driftShift);
+    }
+
+    for(size_t i = 0; i < foreground.size(); i++)
+    {
+        cv::Rect rect = foreground[i] & frameRect;
+
+        cv::Mat background = m_background(rect);
+        cv::Mat average = m_average(rect);
+
+        m_savedBackground[i].copyTo(background);
+        m_savedAverage[i].copyTo(average);
+    }
+}
@@ -0,0 +1,72 @@
+/*
+ *
+ * Copyright (C) 2014  Miroslav Krajicek, Faculty of Informatics Masaryk University (https://github.com/kaajo).
+ * All Rights Reserved.
+ *
+ * This file is part of WebCamCap.
+ *
+ * WebCamCap is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU LGPL version 3 as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WebCamCap is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU LGPL version 3
+ * along with WebCamCap. If not, see <http://www.gnu.org/licenses/lgpl-3.0.txt>.
+ *
+ */
+
+#ifndef BACKGROUNDMODEL_H
+#define BACKGROUNDMODEL_H
+
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+enum class BackgroundMode
+{
+    MAX,    /// brightest value of every channel, flickering lights do not leak into foreground
+    AVERAGE /// running average, less sensitive to one bright frame
+};
+
+/// reference frame for background difference, built during calibration and optionally following lighting drift
+class BackgroundModel
+{
+    BackgroundMode m_mode;
+
+    cv::Mat m_background;   /// 8UC3 reference used by filter
+    cv::Mat m_average;      /// 16SC3, reference scaled by 128 for fixed point running average
+    bool m_averageValid = false;
+    size_t m_frames = 0;
+
+    int m_driftShift;       /// drift update weight is 1 / 2^shift
+
+    std::vector<cv::Mat> m_savedBackground;
+    std::vector<cv::Mat> m_savedAverage;
+
+public:
+    BackgroundModel(BackgroundMode mode = BackgroundMode::MAX, int driftShift = 6);
+
+    void setMode(BackgroundMode mode) {m_mode = mode;}
+    BackgroundMode mode() const {return m_mode;}
+    void setDriftShift(int shift) {m_driftShift = shift;}
+    int driftShift() const {return m_driftShift;}
+
+    void reset();
+
+    /// calibration frame without markers
+    void add(const cv::Mat &frame);
+
+    /// slow running average update, foreground rectangles are left untouched
+    void refresh(const cv::Mat &frame, const std::vector<cv::Rect> &foreground);
+
+    /// shares data, later updates are visible through returned header
+    cv::Mat background() const {return m_background;}
+    size_t frames() const {return m_frames;}
+};
+
+#endif // BACKGROUNDMODEL_H
@@ -0,0 +1,568 @@
+/*
+ *
+ * Copyright (C) 2014  Miroslav Krajicek, Faculty of Informatics Masaryk University (https://github.com/kaajo).
+ * All Rights Reserved.
+ *
+ * This file is part of WebCamCap.
+ *
+ * WebCamCap is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU LGPL version 3 as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WebCamCap is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU LGPL version 3
+ * along with WebCamCap. If not, see <http://www.gnu.org/licenses/lgpl-3.0.txt>.
+ *
+ */
+
+#include "benchmark.h"
+
+#include "room.h"
+#include "syntheticscene.h"
+#include "thresholdkernel.h"
+#include "blobextractor.h"
+#include "pointwelder.h"
+#include "raybatch.h"
+#include "epipolargeometry.h"
+#include "rayrecording.h"
+
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonDocument>
+
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include <algorithm>
+#include <iostream>
+
+using namespace cv;
+
+const QString benchmarkOptionName("benchmark");
+const QString kernelsOptionName("kernels");
+const QString replayRaysOptionName("replay-rays");
+
+bool benchmarkRequested(const QStringList &arguments)
+{
+    return arguments.contains("--" + benchmarkOptionName) || arguments.contains("--" + kernelsOptionName)
+            || arguments.contains("--" + replayRaysOptionName);
+}
+
+/// mean time of one call, first call is not measured so buffers are allocated before
+template<class Function>
+static double millisecondsPerCall(Function function, int repeats)
+{
+    QElapsedTimer timer;
+
+    function();
+    timer.start();
+
+    for(int i = 0; i < repeats; i++)
+    {
+        function();
+    }
+
+    return timer.nsecsElapsed() / 1e6 / repeats;
+}
+
+/// dark noisy background with bright markers on top of it
+static void markerFrame(int rows, int cols, RNG &rng, Mat &frame, Mat &background)
+{
+    Mat noise(rows, cols, CV_8UC3);
+
+    background.create(rows, cols, CV_8UC3);
+    rng.fill(background, RNG::UNIFORM, 0, 80);
+    rng.fill(noise, RNG::UNIFORM, 0, 30);
+    add(background, noise, frame);
+
+    for(int i = 0; i < 50; i++)
+    {
+        circle(frame, cv::Point(rng.uniform(0, cols), rng.uniform(0, rows)), rng.uniform(2, 8), Scalar::all(rng.uniform(100, 256)), CV_FILLED);
+    }
+}
+
+/// backgroundThreshold with median against the OpenCV chain it replaced in UseFilter, results have to be equal
+static bool thresholdBenchmark(int rows, int cols, int repeats)
+{
+    const int diffThreshold = 20, threshold = 100;
+
+    RNG rng(rows);
+    Mat frame, background;
+    markerFrame(rows, cols, rng, frame, background);
+
+    Mat diff, diffGray, diffMask, masked, gray, median, chain;
+
+    double chainTime = millisecondsPerCall([&] {
+        absdiff(frame, background, diff);
+        cvtColor(diff, diffGray, COLOR_BGR2GRAY);
+        cv::threshold(diffGray, diffMask, diffThreshold, 255, THRESH_BINARY);
+        masked.create(frame.size(), frame.type());
+        masked.setTo(Scalar::all(0));
+        frame.copyTo(masked, diffMask);
+        cvtColor(masked, gray, COLOR_BGR2GRAY);
+        medianBlur(gray, median, 3);
+        cv::threshold(median, chain, threshold, 255, THRESH_BINARY);
+    }, repeats);
+
+    Mat mask(rows, cols, CV_8UC1), fused;
+
+    double fusedTime = millisecondsPerCall([&] {
+        backgroundThreshold(frame, background, mask, diffThreshold, threshold);
+        medianBlur(mask, fused, 3);
+    }, repeats);
+
+    Mat different;
+    compare(chain, fused, different, CMP_NE);
+    int differentPixels = countNonZero(different);
+
+    std::cout << "threshold " << cols << "x" << rows << ": OpenCV chain " << chainTime << " ms, fused " << backgroundThresholdKernel()
+              << " " << fusedTime << " ms, " << differentPixels << " pixels differ" << std::endl;
+
+    return differentPixels == 0;
+}
+
+/// BlobExtractor against findContours, contourArea and moments it replaced in UseFilter and MiddleOfContours
+static void blobBenchmark(int discs, int repeats)
+{
+    const int rows = 1080, cols = 1920;
+
+    RNG rng(discs);
+    Mat binary(rows, cols, CV_8UC1, Scalar::all(0));
+
+    for(int i = 0; i < discs; i++)
+    {
+        circle(binary, cv::Point(rng.uniform(4, cols - 4), rng.uniform(4, rows - 4)), 4, Scalar::all(255), CV_FILLED);
+    }
+
+    //findContours modifies its input, copy is measured separately and subtracted
+    Mat contourImage;
+    std::vector<std::vector<cv::Point>> contours;
+    std::vector<glm::vec2> centroids;
+
+    double copyTime = millisecondsPerCall([&] {binary.copyTo(contourImage);}, repeats);
+
+    double contoursTime = millisecondsPerCall([&] {
+        binary.copyTo(contourImage);
+        findContours(contourImage, contours, RETR_EXTERNAL, CHAIN_APPROX_NONE);
+
+        centroids.clear();
+
+        for(size_t i = 0; i < contours.size(); i++)
+        {
+            double area = contourArea(contours[i]);
+
+            if(area > 500 || area <= 10)
+            {
+                continue;
+            }
+
+            Moments contourMoments = moments(contours[i]);
+            centroids.push_back(glm::vec2(contourMoments.m10 / contourMoments.m00, contourMoments.m01 / contourMoments.m00));
+        }
+    }, repeats) - copyTime;
+
+    BlobExtractor extractor(10, 500);
+    std::vector<Blob> blobs;
+
+    double extractorTime = millisecondsPerCall([&] {
+        blobs.clear();
+        extractor.extract(binary, cv::Point(0, 0), blobs);
+    }, repeats);
+
+    std::cout << "blobs " << cols << "x" << rows << ", " << discs << " discs: findContours and moments " << contoursTime << " ms ("
+              << centroids.size() << " blobs), BlobExtractor " << extractorTime << " ms (" << blobs.size() << " blobs)" << std::endl;
+}
+
+static int unionFindRoot(std::vector<int> &parent, int i)
+{
+    while(parent[i] != i)
+    {
+        parent[i] = parent[parent[i]];
+        i = parent[i];
+    }
+
+    return i;
+}
+
+/// PointWelder against grouping by all pairs, every marker is seen from several edges, ghosts are alone
+static bool weldBenchmark(int markers, int repeats)
+{
+    const float radius = 2.0f;
+    const glm::vec3 room(400, 500, 300);
+
+    RNG rng(markers);
+    std::vector<glm::vec3> raw;
+    std::vector<float> weights;
+
+    for(int i = 0; i < markers; i++)
+    {
+        glm::vec3 marker(rng.uniform(0.0f, room.x), rng.uniform(0.0f, room.y), rng.uniform(0.0f, room.z));
+        int duplicates = rng.uniform(3, 9);
+
+        for(int j = 0; j < duplicates; j++)
+        {
+            raw.push_back(marker + 0.2f * glm::vec3(rng.gaussian(1), rng.gaussian(1), rng.gaussian(1)));
+            weights.push_back(rng.uniform(0.0f, 1.0f));
+        }
+    }
+
+    for(int i = 0; i < markers / 2; i++)
+    {
+        raw.push_back(glm::vec3(rng.uniform(0.0f, room.x), rng.uniform(0.0f, room.y), rng.uniform(0.0f, room.z)));
+        weights.push_back(rng.uniform(0.0f, 0.3f));
+    }
+
+    PointWelder welder;
+    std::vector<glm::vec3> welded;
+
+    double weldTime = millisecondsPerCall([&] {
+        welded = raw;
+        welder.weld(welded, weights, radius);
+    }, repeats);
+
+    std::vector<int> parent(raw.size());
+    size_t groups = 0;
+
+    double pairsTime = millisecondsPerCall([&] {
+        for(size_t i = 0; i < raw.size(); i++)
+        {
+            parent[i] = i;
+        }
+
+        for(size_t i = 0; i < raw.size(); i++)
+        {
+            for(size_t j = 0; j < i; j++)
+            {
+                glm::vec3 d = raw[i] - raw[j];
+
+                if(glm::dot(d, d) < radius * radius)
+                {
+                    int a = unionFindRoot(parent, i), b = unionFindRoot(parent, j);
+                    parent[std::max(a, b)] = std::min(a, b);
+                }
+            }
+        }
+
+        groups = 0;
+
+        for(size_t i = 0; i < raw.size(); i++)
+        {
+            groups += unionFindRoot(parent, i) == (int) i;
+        }
+    }, std::max(1, repeats / 10));
+
+    std::cout << "welding " << raw.size() << " raw points of " << markers << " markers: all pairs " << pairsTime << " ms ("
+              << groups << " groups), PointWelder " << weldTime << " ms (" << welded.size() << " points)" << std::endl;
+
+    return groups == welded.size();
+}
+
+/// RayBatch kernel against Line::Intersection of every pair it replaced in Room::Intersection, accepted pairs have to be equal,
+/// epipolar gate of the kernel must not drop any pair of the all-pairs loop
+static bool rayBenchmark(int markers, bool gated, int repeats)
+{
+    const float maxError = 1.0f;
+    const glm::vec3 position1(-50, 250, -50), position2(350, 250, -40);
+
+    RNG rng(markers);
+    std::vector<glm::vec3> points(markers);
+    QVector<Line> first, second;
+
+    //noise makes rays miss each other a little
+    auto noise = [&rng] {return glm::vec3(rng.uniform(-0.3f, 0.3f), rng.uniform(-0.3f, 0.3f), rng.uniform(-0.3f, 0.3f));};
+
+    for(int i = 0; i < markers; i++)
+    {
+        points[i] = glm::vec3(rng.uniform(0.0f, 300.0f), rng.uniform(0.0f, 240.0f), rng.uniform(0.0f, 300.0f));
+        first.append(Line(position1, points[i] + noise() - position1));
+        first.back().m_tmin = 0;
+    }
+
+    //second camera sees markers in other order
+    for(int i = markers - 1; i > 0; i--)
+    {
+        std::swap(points[i], points[rng.uniform(0, i + 1)]);
+    }
+
+    for(int i = 0; i < markers; i++)
+    {
+        second.append(Line(position2, points[i] + noise() - position2));
+        second.back().m_tmin = 0;
+    }
+
+    EpipolarGeometry epipolar;
+    epipolar.set(position1, position2, gated ? 2.0f : 0.0f, maxError);
+
+    std::vector<std::pair<float, int>> sorted;
+    std::vector<RayHit> reference, hits;
+
+    double loopTime = millisecondsPerCall([&] {
+        reference.clear();
+
+        glm::vec3 point;
+        float distance;
+
+        //rays start in cameras, pairs meeting behind them are rejected by segments in kernel
+        for(int i = 0; i < first.size(); i++)
+        {
+            for(int j = 0; j < second.size(); j++)
+            {
+                if(Line::Intersection(first[i], second[j], maxError, point, distance)
+                        && glm::dot(point - position1, first[i].m_directionVector) > 0 && glm::dot(point - position2, second[j].m_directionVector) > 0)
+                {
+                    reference.push_back({i, j, point, distance});
+                }
+            }
+        }
+    }, repeats);
+
+    RayBatch batch;
+
+    double kernelTime = millisecondsPerCall([&] {
+        hits.clear();
+
+        if(gated)
+        {
+            epipolar.sortByAngle(second, sorted);
+            batch.set(second, sorted);
+
+            for(int i = 0; i < first.size(); i++)
+            {
+                epipolar.forCandidateRanges(sorted, first[i], [&](int begin, int end) {intersectRays(first[i], i, batch, begin, end, maxError, hits);});
+            }
+        }
+        else
+        {
+            batch.set(second);
+
+            for(int i = 0; i < first.size(); i++)
+            {
+                intersectRays(first[i], i, batch, 0, batch.size(), maxError, hits);
+            }
+        }
+    }, repeats);
+
+    auto byPair = [](const RayHit &a, const RayHit &b) {return std::make_pair(a.m_first, a.m_second) < std::make_pair(b.m_first, b.m_second);};
+    std::sort(reference.begin(), reference.end(), byPair);
+    std::sort(hits.begin(), hits.end(), byPair);
+
+    bool equal = reference.size() == hits.size();
+    float maxDifference = 0;
+
+    for(size_t i = 0; equal && i < hits.size(); i++)
+    {
+        equal = reference[i].m_first == hits[i].m_first && reference[i].m_second == hits[i].m_second;
+        maxDifference = std::max(maxDifference, glm::distance(reference[i].m_point, hits[i].m_point));
+    }
+
+    std::cout << "rays " << markers << "x" << markers << ": Line::Intersection all pairs " << loopTime * 1000 << " us, RayBatch "
+              << intersectRaysKernel() << (gated ? " epipolar band " : " all pairs ") << kernelTime * 1000 << " us, "
+              << hits.size() << " of " << reference.size() << " pairs, points differ by " << maxDifference << std::endl;
+
+    return equal;
+}
+
+/// optimized kernels against the code they replaced, fails when results differ
+static int kernelBenchmarks(const QCommandLineParser &parser)
+{
+    int repeats = parser.value("repeats").toInt();
+    bool equal = true;
+
+    equal = thresholdBenchmark(480, 640, repeats) && equal;
+    equal = thresholdBenchmark(1080, 1920, repeats) && equal;
+
+    //areas are contour areas in one and pixel counts in the other, blob counts are informative only
+    const int discs[] = {10, 100, 1000, 5000};
+
+    for(int count: discs)
+    {
+        blobBenchmark(count, repeats);
+    }
+
+    const int markers[] = {100, 500, 1000, 2000};
+
+    for(int count: markers)
+    {
+        equal = weldBenchmark(count, repeats) && equal;
+    }
+
+    //microseconds per call, more calls are needed for stable times
+    equal = rayBenchmark(50, false, repeats * 100) && equal;
+    equal = rayBenchmark(50, true, repeats * 100) && equal;
+    equal = rayBenchmark(300, false, repeats * 4) && equal;
+    equal = rayBenchmark(300, true, repeats * 4) && equal;
+
+    return equal ? 0 : 1;
+}
+
+static Room *loadProject(const QString &fileName)
+{
+    QFile file(fileName);
+
+    if(!file.open(QFile::OpenModeFlag::ReadOnly))
+    {
+        std::cout << "cannot open project " << fileName.toStdString() << std::endl;
+        return nullptr;
+    }
+
+    QJsonDocument doc = QJsonDocument::fromJson(file.readAll());
+
+    if(!doc.isObject())
+    {
+        std::cout << fileName.toStdString() << " is not a project file" << std::endl;
+        return nullptr;
+    }
+
+    QVariantMap map = doc.toVariant().toMap();
+
+    Room *room = new Room();
+    room->fromVariantMap(nullptr, map);
+
+    return room;
+}
+
+static int syntheticBenchmark(const QCommandLineParser &parser)
+{
+    Room *room = loadProject(parser.value(benchmarkOptionName));
+
+    if(!room)
+    {
+        return 1;
+    }
+
+    std::vector<CaptureCamera*> cameras = room->getcameras();
+
+    if(cameras.size() < 2 || room->getDimensions().x <= 0 || room->getDimensions().y <= 0 || room->getDimensions().z <= 0)
+    {
+        std::cout << "benchmark needs at least two cameras and room dimensions" << std::endl;
+        delete room;
+        return 1;
+    }
+
+    SyntheticSettings settings;
+    settings.m_fps = parser.value("fps").toDouble();
+    settings.m_noise = parser.value("noise").toFloat();
+    settings.m_occlusion = parser.value("occlusion").toFloat();
+    settings.m_clutter = parser.value("clutter").toInt();
+    settings.m_seed = parser.value("seed").toULongLong();
+
+    size_t markers = parser.value("markers").toUInt();
+    size_t frames = parser.value("frames").toUInt();
+    bool images = parser.isSet("images");
+
+    SyntheticScene scene(cameras, SyntheticScene::randomTrajectories(markers, room->getDimensions(), 20, 0.5, settings.m_seed), settings);
+
+    room->setNumberOfPoints(markers);
+
+    if(images)
+    {
+        for(size_t i = 0; i < cameras.size(); i++)
+        {
+            cameras[i]->setFrameSource(new SyntheticFrameSource(&scene, i));
+            cameras[i]->TurnOn();
+        }
+    }
+
+    if(parser.isSet("save-rays"))
+    {
+        room->startRayRecording();
+    }
+
+    room->Benchmark(scene, frames, parser.isSet("replay"), images);
+
+    bool saved = !parser.isSet("save-rays") || room->saveRayRecording(parser.value("save-rays"));
+
+    if(images)
+    {
+        for(size_t i = 0; i < cameras.size(); i++)
+        {
+            cameras[i]->TurnOff();
+        }
+    }
+
+    delete room;
+
+    return saved ? 0 : 1;
+}
+
+static int replayRays(const QCommandLineParser &parser)
+{
+    if(!parser.isSet("project"))
+    {
+        std::cout << "replay of rays needs --project with cameras the rays were recorded with" << std::endl;
+        return 1;
+    }
+
+    RayRecording recording;
+
+    if(!recording.load(parser.value(replayRaysOptionName)))
+    {
+        std::cout << "cannot read rays from " << parser.value(replayRaysOptionName).toStdString() << std::endl;
+        return 1;
+    }
+
+    Room *room = loadProject(parser.value("project"));
+
+    if(!room)
+    {
+        return 1;
+    }
+
+    size_t mismatches = room->ReplayRays(recording, std::max(parser.value("runs").toInt(), 2));
+
+    delete room;
+
+    return mismatches == 0 && recording.size() > 0 ? 0 : 1;
+}
+
+int runBenchmark(const QStringList &arguments)
+{
+    QCommandLineParser parser;
+    parser.setApplicationDescription("WebCamCap measurements without main window");
+    parser.addHelpOption();
+
+    parser.addOptions({
+        {benchmarkOptionName, "Triangulate synthetic markers seen by cameras of <project>.", "project"},
+        {"frames", "Number of measured frames.", "count", "600"},
+        {"markers", "Number of synthetic markers.", "count", "10"},
+        {"fps", "Frame rate of synthetic scene.", "fps", "60"},
+        {"noise", "Sigma of centroid noise in pixels.", "pixels", "0.5"},
+        {"occlusion", "Probability that a marker is hidden from one camera.", "probability", "0"},
+        {"clutter", "Bright spots in every camera that are not markers.", "count", "0"},
+        {"seed", "Seed of trajectories and noise.", "seed", "0"},
+        {"images", "Render frames and run the whole image pipeline of cameras."},
+        {"replay", "Triangulate every frame twice and report frames with different points."},
+        {"save-rays", "Save rays and points of every benchmark frame to <file>.", "file"},
+        {replayRaysOptionName, "Triangulate rays recorded in <file> again, exit code 1 when any frame differs.", "file"},
+        {"project", "Project the replayed rays were recorded with.", "project"},
+        {"runs", "Triangulations of every replayed frame.", "count", "3"},
+        {kernelsOptionName, "Compare optimized kernels with the code they replaced, exit code 1 when results differ."},
+        {"repeats", "Calls of every measured kernel.", "count", "50"}
+    });
+
+    parser.process(arguments);
+
+    if(parser.isSet(benchmarkOptionName))
+    {
+        return syntheticBenchmark(parser);
+    }
+
+    if(parser.isSet(kernelsOptionName))
+    {
+        return kernelBenchmarks(parser);
+    }
+
+    if(parser.isSet(replayRaysOptionName))
+    {
+        return replayRays(parser);
+    }
+
+    parser.showHelp(1);
+
+    return 1;
+}
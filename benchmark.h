@@ -0,0 +1,40 @@
+/*
+ *
+ * Copyright (C) 2014  Miroslav Krajicek, Faculty of Informatics Masaryk University (https://github.com/kaajo).
+ * All Rights Reserved.
+ *
+ * This file is part of WebCamCap.
+ *
+ * WebCamCap is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU LGPL version 3 as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WebCamCap is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU LGPL version 3
+ * along with WebCamCap. If not, see <http://www.gnu.org/licenses/lgpl-3.0.txt>.
+ *
+ */
+
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <QStringList>
+
+/// true when command line asks for a measurement instead of main window
+bool benchmarkRequested(const QStringList &arguments);
+
+/// runs measurement given on command line, returns exit code of the process
+///
+/// --benchmark project.json   synthetic markers seen by cameras of the project, prints SyntheticStats
+/// --kernels                  optimized kernels against the code they replaced, fails when results differ
+/// --replay-rays rays.bin --project project.json
+///                            rays saved by --save-rays or by "rayRecording" of project triangulated again,
+///                            fails when any frame differs between runs or from the recording
+int runBenchmark(const QStringList &arguments);
+
+#endif // BENCHMARK_H
@@ -0,0 +1,267 @@
+/*
+ *
+ * Copyright (C) 2014  Miroslav Krajicek, Faculty of Informatics Masaryk University (https://github.com/kaajo).
+ * All Rights Reserved.
+ *
+ * This file is part of WebCamCap.
+ *
+ * WebCamCap is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU LGPL version 3 as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WebCamCap is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU LGPL version 3
+ * along with WebCamCap. If not, see <http://www.gnu.org/licenses/lgpl-3.0.txt>.
+ *
+ */
+
+#include "blobextractor.h"
+#include "thresholdkernel.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+BlobExtractor::BlobExtractor(int minArea, int maxArea)
+{
+    m_minArea = minArea;
+    m_maxArea = maxArea;
+}
+
+size_t BlobExtractor::capacity() const
+{
+    return m_rows.capacity() * sizeof(int) + m_labels.capacity();
+}
+
+void BlobExtractor::extract(const cv::Mat &binary, cv::Point offset, std::vector<Blob> &blobs, const cv::Mat &image, int base)
+{
+    CV_Assert(binary.type() == CV_8UC1);
+    CV_Assert(image.empty() || (image.type() == CV_8UC3 && image.size() == binary.size()));
+
+    const bool weighted = !image.empty();
+
+    const int width = binary.cols;
+    const int stride = width + 2;
+
+    m_rows.assign(2 * stride, 0);
+
+    m_labels.clear();
+
+    int *previous = &m_rows[1];
+    int *current = &m_rows[stride + 1];
+
+    for(int y = 0; y < binary.rows; y++)
+    {
+        const uchar *row = binary.ptr<uchar>(y);
+        const uchar *imageRow = weighted ? image.ptr<uchar>(y) : nullptr;
+
+        for(int x = 0; x < width; x++)
+        {
+            if(!row[x])
+            {
+                //markers cover small part of frame, empty mask is skipped by eight pixels
+                uint64_t word = 1;
+
+                if(x + 8 <= width)
+                {
+                    memcpy(&word, row + x, sizeof(word));
+                }
+
+                if(!word)
+                {
+                    std::fill(current + x, current + x + 8, 0);
+                    x += 7;
+                    continue;
+                }
+
+                current[x] = 0;
+                continue;
+            }
+
+            int label;
+
+            if(current[x-1])
+            {
+                //upper left and upper neighbours touch left one, they are already joined
+                label = current[x-1];
+
+                if(previous[x+1] && !previous[x])
+                {
+                    label = m_labels.unite(label, previous[x+1]);
+                }
+            }
+            else if(previous[x])
+            {
+                label = previous[x];
+            }
+            else if(previous[x-1])
+            {
+                label = previous[x-1];
+
+                if(previous[x+1])
+                {
+                    label = m_labels.unite(label, previous[x+1]);
+                }
+            }
+            else if(previous[x+1])
+            {
+                label = previous[x+1];
+            }
+            else
+            {
+                label = m_labels.newLabel(x, y);
+            }
+
+            current[x] = label;
+
+            m_labels.addPixel(label, x, y);
+
+            //gray level is computed only under the mask
+            if(weighted)
+            {
+                int weight = grayLevel(imageRow + 3*x) - base;
+
+                if(weight > 0)
+                {
+                    m_labels.addWeight(label, weight, (long long) weight * x, y);
+                }
+            }
+        }
+
+        std::swap(previous, current);
+    }
+
+    m_labels.blobs(m_minArea, m_maxArea, offset, blobs);
+}
+
+void BlobExtractor::countPerThreshold(const cv::Mat &gray, std::vector<int> &counts) const
+{
+    CV_Assert(gray.type() == CV_8UC1);
+
+    const int width = gray.cols;
+    const int height = gray.rows;
+
+    counts.assign(256, 0);
+
+    //counting sort of pixel indices by gray level, black pixels never pass any threshold
+    std::vector<int> levelStart(257, 0);
+
+    for(int y = 0; y < height; y++)
+    {
+        const uchar *row = gray.ptr<uchar>(y);
+
+        for(int x = 0; x < width; x++)
+        {
+            ++levelStart[row[x] + 1];
+        }
+    }
+
+    for(int level = 1; level <= 256; level++)
+    {
+        levelStart[level] += levelStart[level - 1];
+    }
+
+    std::vector<int> order(width * height - levelStart[1]);
+    std::vector<int> fill(levelStart.begin(), levelStart.end() - 1);
+
+    for(int y = 0; y < height; y++)
+    {
+        const uchar *row = gray.ptr<uchar>(y);
+
+        for(int x = 0; x < width; x++)
+        {
+            if(row[x])
+            {
+                order[fill[row[x]]++ - levelStart[1]] = y * width + x;
+            }
+        }
+    }
+
+    std::vector<int> parent(width * height, -1);
+    std::vector<int> size(width * height, 0);
+
+    auto find = [&parent](int p)
+    {
+        while(parent[p] != p)
+        {
+            parent[p] = parent[parent[p]];
+            p = parent[p];
+        }
+
+        return p;
+    };
+
+    auto inRange = [this](int area)
+    {
+        return area >= m_minArea && area <= m_maxArea;
+    };
+
+    int blobs = 0;
+
+    for(int level = 255; level > 0; level--)
+    {
+        for(int i = levelStart[level] - levelStart[1]; i < levelStart[level + 1] - levelStart[1]; i++)
+        {
+            int p = order[i];
+            int x = p % width;
+            int y = p / width;
+
+            parent[p] = p;
+            size[p] = 1;
+
+            if(inRange(1))
+            {
+                ++blobs;
+            }
+
+            for(int dy = -1; dy <= 1; dy++)
+            {
+                for(int dx = -1; dx <= 1; dx++)
+                {
+                    int nx = x + dx, ny = y + dy;
+
+                    if((dx == 0 && dy == 0) || nx < 0 || ny < 0 || nx >= width || ny >= height)
+                    {
+                        continue;
+                    }
+
+                    int q = ny * width + nx;
+
+                    //brighter or equal pixels are already in the tree
+                    if(parent[q] == -1)
+                    {
+                        continue;
+                    }
+
+                    int rootP = find(p);
+                    int rootQ = find(q);
+
+                    if(rootP == rootQ)
+                    {
+                        continue;
+                    }
+
+                    blobs -= inRange(size[rootP]) + inRange(size[rootQ]);
+
+                    if(size[rootP] < size[rootQ])
+                    {
+                        std::swap(rootP, rootQ);
+                    }
+
+                    parent[rootQ] = rootP;
+                    size[rootP] += size[rootQ];
+
+                    blobs += inRange(size[rootP]);
+                }
+            }
+        }
+
+        //all pixels brighter than level - 1 are in
+        counts[level - 1] = blobs;
+    }
+}
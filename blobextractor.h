@@ -0,0 +1,63 @@
+/*
+ *
+ * Copyright (C) 2014  Miroslav Krajicek, Faculty of Informatics Masaryk University (https://github.com/kaajo).
+ * All Rights Reserved.
+ *
+ * This file is part of WebCamCap.
+ *
+ * WebCamCap is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU LGPL version 3 as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WebCamCap is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU LGPL version 3
+ * along with WebCamCap. If not, see <http://www.gnu.org/licenses/lgpl-3.0.txt>.
+ *
+ */
+
+#ifndef BLOBEXTRACTOR_H
+#define BLOBEXTRACTOR_H
+
+#include "componentlabels.h"
+
+/// 8-connected components of binary mask, statistics are collected during one labeling pass
+class BlobExtractor
+{
+    //labels of previous and current row, padded by one zero on both sides
+    std::vector<int> m_rows;
+    ComponentLabels m_labels;
+
+    int m_minArea;
+    int m_maxArea;
+
+public:
+    BlobExtractor(int minArea = 10, int maxArea = 500);
+
+    void setAreaLimits(int minArea, int maxArea) {m_minArea = minArea; m_maxArea = maxArea;}
+    int minArea() const {return m_minArea;}
+    int maxArea() const {return m_maxArea;}
+
+    /// bytes reserved by internal buffers
+    size_t capacity() const;
+
+    /**
+     * @brief appends blobs with area in <minArea, maxArea>, offset is added to coordinates
+     * @param image optional BGR image of the same size, pixels are weighted by gray level above base
+     */
+    void extract(const cv::Mat &binary, cv::Point offset, std::vector<Blob> &blobs, const cv::Mat &image = cv::Mat(), int base = 0);
+
+    /**
+     * @brief number of blobs with area in <minArea, maxArea> in mask gray > t, for every t in 0..255
+     *
+     * Pixels are added from the brightest level down and joined by union-find (component tree),
+     * so all thresholds are evaluated in one pass instead of labeling 256 masks.
+     */
+    void countPerThreshold(const cv::Mat &gray, std::vector<int> &counts) const;
+};
+
+#endif // BLOBEXTRACTOR_H
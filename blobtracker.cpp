@@ -0,0 +1,139 @@
+/*
+ *
+ * Copyright (C) 2014  Miroslav Krajicek, Faculty of Informatics Masaryk University (https://github.com/kaajo).
+ * All Rights Reserved.
+ *
+ * This file is part of WebCamCap.
+ *
+ * WebCamCap is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU LGPL version 3 as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WebCamCap is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU LGPL version 3
+ * along with WebCamCap. If not, see <http://www.gnu.org/licenses/lgpl-3.0.txt>.
+ *
+ */
+
+#include "blobtracker.h"
+
+using glm::vec2;
+
+BlobTracker::BlobTracker(int windowRadius, size_t fullScanInterval)
+{
+    m_windowRadius = windowRadius;
+    m_fullScanInterval = fullScanInterval;
+}
+
+void BlobTracker::reset()
+{
+    m_tracks.clear();
+    m_frameCounter = 0;
+    m_lost = true;
+}
+
+bool BlobTracker::needsFullScan() const
+{
+    return m_lost || m_tracks.empty() || m_fullScanInterval == 0 || m_frameCounter % m_fullScanInterval == 0;
+}
+
+void BlobTracker::predictWindows(cv::Size frameSize, std::vector<cv::Rect> &windows) const
+{
+    cv::Rect frameRect(0, 0, frameSize.width, frameSize.height);
+
+    windows.clear();
+
+    for(size_t i = 0; i < m_tracks.size(); i++)
+    {
+        vec2 prediction = m_tracks[i].m_position + m_tracks[i].m_velocity;
+
+        //faster blobs get larger window, prediction error grows with speed
+        int radius = m_windowRadius + (int) glm::length(m_tracks[i].m_velocity);
+
+        cv::Rect window((int) prediction.x - radius, (int) prediction.y - radius, 2*radius + 1, 2*radius + 1);
+        window &= frameRect;
+
+        if(window.area() == 0)
+        {
+            continue;
+        }
+
+        //blob in two windows would be found twice
+        bool merged = true;
+
+        while(merged)
+        {
+            merged = false;
+
+            for(size_t j = 0; j < windows.size(); j++)
+            {
+                if((windows[j] & window).area() > 0)
+                {
+                    window |= windows[j];
+                    windows.erase(windows.begin() + j);
+                    merged = true;
+                    break;
+                }
+            }
+        }
+
+        windows.push_back(window);
+    }
+}
+
+void BlobTracker::update(const std::vector<vec2> &centroids, bool fullScan)
+{
+    ++m_frameCounter;
+
+    m_matched.assign(centroids.size(), false);
+
+    bool lost = false;
+    float maxDistance = m_windowRadius;
+
+    for(size_t i = 0; i < m_tracks.size(); i++)
+    {
+        vec2 prediction = m_tracks[i].m_position + m_tracks[i].m_velocity;
+
+        float minDistance = maxDistance + glm::length(m_tracks[i].m_velocity);
+        int nearest = -1;
+
+        for(size_t j = 0; j < centroids.size(); j++)
+        {
+            float distance = glm::distance(prediction, centroids[j]);
+
+            if(!m_matched[j] && distance < minDistance)
+            {
+                minDistance = distance;
+                nearest = j;
+            }
+        }
+
+        if(nearest == -1)
+        {
+            //drop track, full scan will decide if marker is really gone
+            lost = true;
+            m_tracks.erase(m_tracks.begin() + i);
+            --i;
+            continue;
+        }
+
+        m_matched[nearest] = true;
+        m_tracks[i].m_velocity = centroids[nearest] - m_tracks[i].m_position;
+        m_tracks[i].m_position = centroids[nearest];
+    }
+
+    for(size_t j = 0; j < centroids.size(); j++)
+    {
+        if(!m_matched[j])
+        {
+            m_tracks.push_back({centroids[j], vec2(0,0)});
+        }
+    }
+
+    m_lost = lost && !fullScan;
+}
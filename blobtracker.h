@@ -0,0 +1,68 @@
+/*
+ *
+ * Copyright (C) 2014  Miroslav Krajicek, Faculty of Informatics Masaryk University (https://github.com/kaajo).
+ * All Rights Reserved.
+ *
+ * This file is part of WebCamCap.
+ *
+ * WebCamCap is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU LGPL version 3 as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WebCamCap is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU LGPL version 3
+ * along with WebCamCap. If not, see <http://www.gnu.org/licenses/lgpl-3.0.txt>.
+ *
+ */
+
+#ifndef BLOBTRACKER_H
+#define BLOBTRACKER_H
+
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <opencv2/core/core.hpp>
+
+class BlobTrack
+{
+public:
+    glm::vec2 m_position;
+    glm::vec2 m_velocity;
+};
+
+/// predicts 2D positions of blobs, so only small windows around them have to be processed
+class BlobTracker
+{
+    std::vector<BlobTrack> m_tracks;
+    std::vector<bool> m_matched;
+
+    size_t m_frameCounter = 0;
+    size_t m_fullScanInterval;
+    int m_windowRadius;
+    bool m_lost = true;
+
+public:
+    BlobTracker(int windowRadius = 24, size_t fullScanInterval = 30);
+
+    void setWindowRadius(int radius) {m_windowRadius = radius;}
+    void setFullScanInterval(size_t interval) {m_fullScanInterval = interval;}
+    int windowRadius() const {return m_windowRadius;}
+    size_t fullScanInterval() const {return m_fullScanInterval;}
+
+    void reset();
+
+    /// new markers can appear anywhere, full frame has to be scanned periodically and after losing a track
+    bool needsFullScan() const;
+
+    /// predicted windows clipped to frame, overlapping windows are merged
+    void predictWindows(cv::Size frameSize, std::vector<cv::Rect> &windows) const;
+
+    void update(const std::vector<glm::vec2> &centroids, bool fullScan);
+};
+
+#endif // BLOBTRACKER_H
@@ -0,0 +1,216 @@
+/*
+ *
+ * Copyright (C) 2014  Miroslav Krajicek, Faculty of Informatics Masaryk University (https://github.com/kaajo).
+ * All Rights Reserved.
+ *
+ * This file is part of WebCamCap.
+ *
+ * WebCamCap is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU LGPL version 3 as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WebCamCap is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU LGPL version 3
+ * along with WebCamCap. If not, see <http://www.gnu.org/licenses/lgpl-3.0.txt>.
+ *
+ */
+
+#include "cameracache.h"
+
+#include <cstring>
+
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+static const char cacheMagic[8] = {'W', 'C', 'C', 'R', 'A', 'Y', 'S', '\0'};
+static const quint32 cacheVersion = 1;
+
+const qint64 CameraCache::maxBytes;
+
+//native byte order, files are not meant to be moved between machines
+class CacheHeader
+{
+public:
+    char m_magic[8];
+    quint32 m_version;
+    qint32 m_width;
+    qint32 m_height;
+    qint32 m_hasProjection;
+    char m_key[64];
+    float m_rotation[16];
+    float m_cameraMatrix[12];
+    float m_projectionMatrix[12];
+};
+
+//rays start on cache line boundary, mapping itself is page aligned
+static const qint64 dataOffset = (sizeof(CacheHeader) + 63) & ~63;
+
+static void readMatrix(const float *source, int rows, int cols, cv::Mat &matrix)
+{
+    matrix.create(rows, cols, CV_32F);
+
+    for(int i = 0; i < rows; i++)
+    {
+        for(int j = 0; j < cols; j++)
+        {
+            matrix.at<float>(i,j) = source[i*cols + j];
+        }
+    }
+}
+
+static bool writeMatrix(const cv::Mat &matrix, int rows, int cols, float *destination)
+{
+    if(matrix.rows != rows || matrix.cols != cols || matrix.type() != CV_32F)
+    {
+        return false;
+    }
+
+    for(int i = 0; i < rows; i++)
+    {
+        for(int j = 0; j < cols; j++)
+        {
+            destination[i*cols + j] = matrix.at<float>(i,j);
+        }
+    }
+
+    return true;
+}
+
+QString CameraCache::directory()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/rays";
+}
+
+QString CameraCache::fileName(const QByteArray &key)
+{
+    return directory() + "/" + key.toHex() + ".rays";
+}
+
+bool CameraCache::load(const QByteArray &key, cv::Mat &rotation, cv::Mat &cameraMatrix, cv::Mat &projectionMatrix, PixelRayTable &rays)
+{
+    std::shared_ptr<QFile> file = std::make_shared<QFile>(fileName(key));
+
+    if(key.size() > (int) sizeof(CacheHeader::m_key) || !file->open(QIODevice::ReadOnly) || file->size() < dataOffset)
+    {
+        return false;
+    }
+
+    const uchar *data = file->map(0, file->size());
+
+    if(!data)
+    {
+        return false;
+    }
+
+    CacheHeader header;
+    std::memcpy(&header, data, sizeof(CacheHeader));
+
+    if(std::memcmp(header.m_magic, cacheMagic, sizeof(cacheMagic)) != 0 || header.m_version != cacheVersion
+            || std::memcmp(header.m_key, key.constData(), key.size()) != 0
+            || file->size() != dataOffset + (qint64) header.m_width * header.m_height * 3 * sizeof(float))
+    {
+        return false;
+    }
+
+    readMatrix(header.m_rotation, 4, 4, rotation);
+    readMatrix(header.m_cameraMatrix, 3, 4, cameraMatrix);
+
+    if(header.m_hasProjection)
+    {
+        readMatrix(header.m_projectionMatrix, 3, 4, projectionMatrix);
+    }
+    else
+    {
+        projectionMatrix.release();
+    }
+
+    rays.map(file, data + dataOffset, header.m_width, header.m_height);
+
+#if QT_VERSION >= QT_VERSION_CHECK(5, 10, 0)
+    //modification time orders files for eviction, used file becomes the newest
+    file->setFileTime(QDateTime::currentDateTime(), QFileDevice::FileModificationTime);
+#endif
+
+    return true;
+}
+
+bool CameraCache::store(const QByteArray &key, const QByteArray &replacedKey, const cv::Mat &rotation, const cv::Mat &cameraMatrix, const cv::Mat &projectionMatrix, const PixelRayTable &rays)
+{
+    if(key.size() > (int) sizeof(CacheHeader::m_key) || rays.empty() || !rays.rays().isContinuous() || !QDir().mkpath(directory()))
+    {
+        return false;
+    }
+
+    CacheHeader header;
+    std::memset(&header, 0, sizeof(CacheHeader));
+    std::memcpy(header.m_magic, cacheMagic, sizeof(cacheMagic));
+    std::memcpy(header.m_key, key.constData(), key.size());
+    header.m_version = cacheVersion;
+    header.m_width = rays.width();
+    header.m_height = rays.height();
+
+    if(!writeMatrix(rotation, 4, 4, header.m_rotation) || !writeMatrix(cameraMatrix, 3, 4, header.m_cameraMatrix))
+    {
+        return false;
+    }
+
+    header.m_hasProjection = writeMatrix(projectionMatrix, 3, 4, header.m_projectionMatrix);
+
+    //other instance of application can read the directory, file appears only when complete
+    QSaveFile file(fileName(key));
+
+    if(!file.open(QIODevice::WriteOnly))
+    {
+        return false;
+    }
+
+    QByteArray padding(dataOffset - sizeof(CacheHeader), '\0');
+
+    file.write((const char*) &header, sizeof(CacheHeader));
+    file.write(padding);
+    file.write((const char*) rays.rays().data, rays.bytes());
+
+    if(!file.commit())
+    {
+        return false;
+    }
+
+    //mapping of removed file stays valid until it is unmapped
+    if(!replacedKey.isEmpty() && replacedKey != key)
+    {
+        QFile::remove(fileName(replacedKey));
+    }
+
+    evict(maxBytes, key);
+
+    return true;
+}
+
+void CameraCache::evict(qint64 limit, const QByteArray &key)
+{
+    QFileInfoList files = QDir(directory()).entryInfoList(QStringList("*.rays"), QDir::Files, QDir::Time | QDir::Reversed);
+    QString keep = QFileInfo(fileName(key)).absoluteFilePath();
+    qint64 bytes = 0;
+
+    for(const QFileInfo &info: files)
+    {
+        bytes += info.size();
+    }
+
+    //oldest first
+    for(int i = 0; i < files.size() && bytes > limit; i++)
+    {
+        if(files[i].absoluteFilePath() != keep && QFile::remove(files[i].absoluteFilePath()))
+        {
+            bytes -= files[i].size();
+        }
+    }
+}
@@ -0,0 +1,58 @@
+/*
+ *
+ * Copyright (C) 2014  Miroslav Krajicek, Faculty of Informatics Masaryk University (https://github.com/kaajo).
+ * All Rights Reserved.
+ *
+ * This file is part of WebCamCap.
+ *
+ * WebCamCap is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU LGPL version 3 as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WebCamCap is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU LGPL version 3
+ * along with WebCamCap. If not, see <http://www.gnu.org/licenses/lgpl-3.0.txt>.
+ *
+ */
+
+#ifndef CAMERACACHE_H
+#define CAMERACACHE_H
+
+#include "pixelraytable.h"
+
+#include <QByteArray>
+#include <QString>
+
+/**
+ * @brief derived camera data on disk, one file per key in cache directory
+ *
+ * Key is hash of all parameters the data were computed from, so stale files are never read.
+ * File replaced by new calibration of a camera is removed on store, files left by other projects
+ * are evicted least recently used first when directory grows over maxBytes.
+ * Ray table is not copied on load, it stays in memory mapped file.
+ */
+class CameraCache
+{
+public:
+    /// about ten full HD ray tables
+    static const qint64 maxBytes = 256 * 1024 * 1024;
+
+    static QString directory();
+    static QString fileName(const QByteArray &key);
+
+    /// fills matrices and maps ray table, false if there is no valid file for key
+    static bool load(const QByteArray &key, cv::Mat &rotation, cv::Mat &cameraMatrix, cv::Mat &projectionMatrix, PixelRayTable &rays);
+
+    /// projection matrix can be empty if intrinsics are not known, file of replacedKey is removed
+    static bool store(const QByteArray &key, const QByteArray &replacedKey, const cv::Mat &rotation, const cv::Mat &cameraMatrix, const cv::Mat &projectionMatrix, const PixelRayTable &rays);
+
+    /// removes least recently used files until directory holds at most limit bytes, file of key is kept
+    static void evict(qint64 limit, const QByteArray &key);
+};
+
+#endif // CAMERACACHE_H
@@ -0,0 +1,161 @@
+/*
+ *
+ * Copyright (C) 2014  Miroslav Krajicek, Faculty of Informatics Masaryk University (https://github.com/kaajo).
+ * All Rights Reserved.
+ *
+ * This file is part of WebCamCap.
+ *
+ * WebCamCap is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU LGPL version 3 as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WebCamCap is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU LGPL version 3
+ * along with WebCamCap. If not, see <http://www.gnu.org/licenses/lgpl-3.0.txt>.
+ *
+ */
+
+#include "cameratopology.h"
+
+#include <algorithm>
+
+using glm::vec2;
+using glm::vec3;
+
+//pairs sharing less of the room are not worth the intersection time
+static const float minOverlap = 0.01f;
+
+std::vector<CameraPair> CameraTopology::score(const std::vector<CaptureCamera*> &cameras, vec3 roomDimensions, int samples)
+{
+    std::vector<vec3> grid;
+    grid.reserve(samples * samples * samples);
+
+    for(int z = 0; z < samples; z++)
+    {
+        for(int y = 0; y < samples; y++)
+        {
+            for(int x = 0; x < samples; x++)
+            {
+                grid.push_back(vec3(x + 0.5f, y + 0.5f, z + 0.5f) / (float) samples * roomDimensions);
+            }
+        }
+    }
+
+    std::vector<std::vector<char>> visible(cameras.size(), std::vector<char>(grid.size()));
+    vec2 pixel;
+
+    for(size_t c = 0; c < cameras.size(); c++)
+    {
+        for(size_t s = 0; s < grid.size(); s++)
+        {
+            visible[c][s] = cameras[c]->ProjectPoint(grid[s], pixel);
+        }
+    }
+
+    std::vector<CameraPair> pairs;
+
+    for(size_t i = 0; i < cameras.size(); i++)
+    {
+        vec3 position1 = cameras[i]->getPosition();
+
+        for(size_t j = i + 1; j < cameras.size(); j++)
+        {
+            vec3 position2 = cameras[j]->getPosition();
+
+            CameraPair pair;
+            pair.m_index1 = i;
+            pair.m_index2 = j;
+            pair.m_baseline = glm::distance(position1, position2);
+
+            size_t shared = 0;
+            double angleSum = 0, sineSum = 0;
+
+            for(size_t s = 0; s < grid.size(); s++)
+            {
+                if(!visible[i][s] || !visible[j][s])
+                {
+                    continue;
+                }
+
+                vec3 ray1 = grid[s] - position1, ray2 = grid[s] - position2;
+                float length = glm::length(ray1) * glm::length(ray2);
+
+                if(length == 0)
+                {
+                    continue;
+                }
+
+                float angle = acos(glm::clamp(glm::dot(ray1, ray2) / length, -1.0f, 1.0f));
+
+                angleSum += angle;
+                sineSum += sin(angle);
+                ++shared;
+            }
+
+            if(shared)
+            {
+                pair.m_overlap = (float) shared / grid.size();
+                pair.m_convergence = glm::degrees(angleSum / shared);
+                pair.m_score = pair.m_overlap * sineSum / shared;
+            }
+
+            pairs.push_back(pair);
+        }
+    }
+
+    return pairs;
+}
+
+std::vector<CameraPair> CameraTopology::select(const std::vector<CameraPair> &pairs, size_t cameraCount, int k)
+{
+    bool anyOverlap = std::any_of(pairs.begin(), pairs.end(), [](const CameraPair &pair) {return pair.m_overlap >= minOverlap;});
+
+    if(!anyOverlap)
+    {
+        return pairs;
+    }
+
+    std::vector<char> chosen(pairs.size(), k <= 0);
+
+    if(k > 0)
+    {
+        std::vector<size_t> order;
+
+        for(size_t c = 0; c < cameraCount; c++)
+        {
+            order.clear();
+
+            for(size_t p = 0; p < pairs.size(); p++)
+            {
+                if(pairs[p].m_index1 == c || pairs[p].m_index2 == c)
+                {
+                    order.push_back(p);
+                }
+            }
+
+            std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {return pairs[a].m_score > pairs[b].m_score;});
+
+            for(size_t p = 0; p < order.size() && p < (size_t) k; p++)
+            {
+                chosen[order[p]] = true;
+            }
+        }
+    }
+
+    std::vector<CameraPair> selected;
+
+    for(size_t p = 0; p < pairs.size(); p++)
+    {
+        if(chosen[p] && pairs[p].m_overlap >= minOverlap)
+        {
+            selected.push_back(pairs[p]);
+        }
+    }
+
+    return selected;
+}
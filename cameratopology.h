@@ -0,0 +1,63 @@
+/*
+ *
+ * Copyright (C) 2014  Miroslav Krajicek, Faculty of Informatics Masaryk University (https://github.com/kaajo).
+ * All Rights Reserved.
+ *
+ * This file is part of WebCamCap.
+ *
+ * WebCamCap is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU LGPL version 3 as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WebCamCap is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU LGPL version 3
+ * along with WebCamCap. If not, see <http://www.gnu.org/licenses/lgpl-3.0.txt>.
+ *
+ */
+
+#ifndef CAMERATOPOLOGY_H
+#define CAMERATOPOLOGY_H
+
+#include "capturecamera.h"
+
+#include <vector>
+
+/// camera pair considered for triangulation, computed when cameras or room change
+class CameraPair
+{
+public:
+    size_t m_index1, m_index2;
+    float m_overlap = 0;        /// part of room samples seen by both cameras, <0, 1>
+    float m_convergence = 0;    /// mean angle of rays of both cameras to shared samples, degrees
+    float m_baseline = 0;       /// distance of cameras
+    float m_score = 0;
+};
+
+/**
+ * @brief chooses camera pairs for triangulation by the part of the room both cameras see
+ *
+ * Room box is sampled by regular grid and every sample is projected by CaptureCamera::ProjectPoint.
+ * Score of pair is overlap times mean sine of convergence angle, rays meeting at right angle
+ * give the smallest depth error, nearly parallel rays of close cameras give none.
+ */
+class CameraTopology
+{
+public:
+    /// every pair of cameras, samples per room axis
+    static std::vector<CameraPair> score(const std::vector<CaptureCamera*> &cameras, glm::vec3 roomDimensions, int samples = 10);
+
+    /**
+     * @brief k best pairs of every camera, pair is kept if one of its cameras chose it
+     *
+     * k = 0 keeps all pairs with overlap. If no pair has overlap (room or cameras not set up yet),
+     * all pairs are returned so triangulation still runs.
+     */
+    static std::vector<CameraPair> select(const std::vector<CameraPair> &pairs, size_t cameraCount, int k);
+};
+
+#endif // CAMERATOPOLOGY_H
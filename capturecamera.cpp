@@ -21,12 +21,18 @@
  */
 
 #include "capturecamera.h"
+#include "thresholdkernel.h"
+#include "cameracache.h"
+#include "allocationcounter.h"
 
 #include <QVariant>
 #include <QVariantMap>
 #include <QMessageBox>
 #include <QVBoxLayout>
 #include <QMatrix4x4>
+#include <QCryptographicHash>
+
+#include <algorithm>
 
 using namespace cv;
 using glm::vec2;
@@ -40,6 +46,8 @@ cv::Mat CaptureCamera::distortionCoeffs() const
 void CaptureCamera::setDistortionCoeffs(const cv::Mat &distortionCoeffs)
 {
     m_distortionCoeffs = distortionCoeffs;
+    m_undistortMap1.release();
+    m_undistortMap2.release();
 }
 
 cv::Mat CaptureCamera::cameraMatrix() const
@@ -51,7 +59,11 @@ void CaptureCamera::setCameraMatrix(const cv::Mat &cameraMatrix)
 {
     cameraMatrix.convertTo(m_IntrinsicMatrix, CV_32F);
 
-    m_projectionMatrix = m_IntrinsicMatrix * m_CameraMatrix;
+    //projection matrix and rays of INTRINSIC model depend on it
+    computeNewParameters();
+
+    m_undistortMap1.release();
+    m_undistortMap2.release();
 }
 
 cv::Mat CaptureCamera::cameraProjectionMatrix() const
@@ -89,6 +101,7 @@ CaptureCamera::CaptureCamera(vec2 resolution, vec3 pos, vec3 roomDimensions, QSt
     m_fov = angle;
     m_roomDimensions = roomDimensions;
     m_resolution = resolution;
+    m_frameSource = new DeviceFrameSource(ID);
 
     computeNewParameters();
 
@@ -100,8 +113,6 @@ CaptureCamera::CaptureCamera(vec2 resolution, vec3 pos, vec3 roomDimensions, QSt
     useBackgroundSub = backgroudSubstractor;
 
     m_QtWidgetViewer = new CamWidget;
-    CQtOpenCVViewerGl *t = m_QtWidgetViewer->getImageViewer();
-    connect(this, SIGNAL(imageRead(cv::Mat)), t, SLOT(showImage(cv::Mat)));
     connect(m_QtWidgetViewer, SIGNAL(activeCam(bool)), this, SLOT(activeCam(bool)));
     connect(m_QtWidgetViewer, SIGNAL(turnedOnCam(bool)), this, SLOT(turnedOnCam(bool)));
     connect(m_QtWidgetViewer, SIGNAL(thresholdCam(size_t)), this, SLOT(thresholdCam(size_t)));
@@ -113,19 +124,38 @@ CaptureCamera::~CaptureCamera()
     TurnOff();
     delete m_QtWidgetViewer;
     delete backgroundExtractor;
+    delete m_frameSource;
+}
+
+void CaptureCamera::setFrameSource(FrameSource *source)
+{
+    bool turnedOn = m_turnedOn;
+
+    TurnOff();
+
+    delete m_frameSource;
+    m_frameSource = source;
+
+    if(turnedOn)
+    {
+        TurnOn();
+    }
 }
 
-QVector<Line> CaptureCamera::RecordNextFrame()
+const QVector<Line> &CaptureCamera::RecordNextFrame()
 {
-    lines.clear();
+    //resize keeps capacity, clear frees it in Qt older than 5.7
+    lines.resize(0);
 
     if(!m_turnedOn)
     {
-        QVector<Line> blank;
-        return blank;
+        return lines;
     }
 
-    camera >> frame;
+    if(!GrabFrame(frame))
+    {
+        return lines;
+    }
 
     UseFilter();
 
@@ -137,7 +167,7 @@ QVector<Line> CaptureCamera::RecordNextFrame()
 
     if(m_showWindow)
     {
-        emit imageRead(frame);
+        m_QtWidgetViewer->getImageViewer()->submitFrame(frame);
     }
 
     return lines;
@@ -156,7 +186,11 @@ std::vector<vec2> CaptureCamera::RecordNextFrame2D()
     QTime timer;
     timer.start();
 
-    camera >> frame;
+    if(!GrabFrame(frame))
+    {
+        std::vector<vec2> blank;
+        return blank;
+    }
 
     std::cout << timer.elapsed() << std::endl;
 
@@ -167,7 +201,7 @@ std::vector<vec2> CaptureCamera::RecordNextFrame2D()
 
     if(m_showWindow)
     {
-        emit imageRead(frame);
+        m_QtWidgetViewer->getImageViewer()->submitFrame(frame);
     }
 
     NormalizeContours();
@@ -175,90 +209,261 @@ std::vector<vec2> CaptureCamera::RecordNextFrame2D()
     return centerOfContour;
 }
 
-void CaptureCamera::UseFilter()
+bool CaptureCamera::GrabFrame(Mat &image)
 {
+    return m_frameBuffer.takeLatest(image, m_frameTimestamp, 1000) && !image.empty();
+}
+
+void CaptureCamera::AllocateWorkspace(int rows, int cols)
+{
+    m_undistorted.create(rows, cols, CV_8UC3);
+    frameTemp.create(rows, cols, CV_8UC3);
+    m_gray.create(rows, cols, CV_8UC1);
+    m_binary.create(rows, cols, CV_8UC1);
+
     if(!m_distortionCoeffs.empty() && !m_IntrinsicMatrix.empty())
+    {
+        initUndistortRectifyMap(m_IntrinsicMatrix, m_distortionCoeffs, Mat(), m_IntrinsicMatrix, Size(cols, rows), CV_16SC2, m_undistortMap1, m_undistortMap2);
+    }
+
+    m_allocationFrames = 0;
+    m_allocatingFrames = 0;
+    m_steadyAllocations = 0;
+}
+
+void CaptureCamera::CountAllocations()
+{
+    size_t allocations = AllocationCounter::count();
+
+    //first frames size buffers inside OpenCV and containers, mark of the first one may come from other thread
+    if(m_allocationFrames++ >= allocationWarmUpFrames)
+    {
+        size_t frameAllocations = allocations - m_allocationMark;
+
+        m_steadyAllocations += frameAllocations;
+        m_allocatingFrames += frameAllocations > 0;
+    }
+
+    m_allocationMark = allocations;
+}
+
+void CaptureCamera::UseFilter()
+{
+    CountAllocations();
+
+    m_frameUndistorted = false;
+
+    //without preview only centroids are undistorted, see UndistortCentroids
+    if(!m_distortionCoeffs.empty() && !m_IntrinsicMatrix.empty() && (!m_undistortCentroids || m_showWindow))
     {
         GetUndisortedPosition();
+        m_frameUndistorted = true;
+    }
+
+    frameTemp.create(frame.size(), frame.type());
+
+    //MOG has to learn from the whole frame
+    m_fullScan = !m_tracking || useBackgroundSub || m_tracker.needsFullScan();
+
+    m_blobs.clear();
+
+    if(m_fullScan)
+    {
+        FilterRegion(Rect(0, 0, frame.cols, frame.rows));
+    }
+    else
+    {
+        m_tracker.predictWindows(frame.size(), m_trackingWindows);
+
+        for(size_t i = 0; i < m_trackingWindows.size(); i++)
+        {
+            FilterRegion(m_trackingWindows[i]);
+        }
+    }
+
+    //follow lighting drift, before anything is drawn into frame
+    if(m_backgroundRefresh && !useBackgroundSub && !frameBackground.empty())
+    {
+        m_foregroundRects.clear();
+
+        for(size_t i = 0; i < m_blobs.size(); i++)
+        {
+            const Rect &box = m_blobs[i].m_boundingBox;
+            m_foregroundRects.push_back(Rect(box.x - 4, box.y - 4, box.width + 8, box.height + 8));
+        }
+
+        m_backgroundModel.refresh(frame, m_foregroundRects);
+    }
+
+    if(m_showWindow)
+    {
+        for(size_t i = 0; i < m_blobs.size(); i++)
+        {
+            rectangle(frame, m_blobs[i].m_boundingBox, contourColor);
+        }
+
+        if(!m_fullScan)
+        {
+            for(size_t i = 0; i < m_trackingWindows.size(); i++)
+            {
+                rectangle(frame, m_trackingWindows[i], CV_RGB(255,255,0));
+            }
+        }
     }
+}
+
+void CaptureCamera::FilterRegion(const Rect &region)
+{
+    //views into persistent buffers, nothing is allocated
+    Mat image = frame(region);
+    Mat gray = m_gray(region);
+    Mat binary = m_binary(region);
 
     if(ROI)
     {
-        frame.copyTo(ROIMask, ROIMask);
-        ROIMask.copyTo(frame);
+        image.setTo(Scalar::all(0), m_ROIInverse(region));
+    }
+
+    //runs are thresholded straight from frame, no mask buffers, median or morphology
+    if(m_detector == DetectorMode::RUNLENGTH && !useBackgroundSub)
+    {
+        m_runLengthDetector.detect(image, frameBackground.empty() ? Mat() : frameBackground(region), region.tl(), m_blobs, m_thresholdValue);
+        return;
     }
 
     if(useBackgroundSub)
     {
+        Mat temp = frameTemp(region);
+
+        temp.setTo(Scalar::all(0));
+
         backgroundExtractor->operator ()(frame, MOGMask);
         frame.copyTo(frameTemp,MOGMask);
+
+        cvtColor(temp, gray, COLOR_BGR2GRAY);
+        medianBlur(gray, binary, 3);
+
+        threshold(binary, binary, m_thresholdValue, 255, THRESH_BINARY);
+    }
+    else if(!frameBackground.empty())
+    {
+        //median of binary mask equals thresholded median of gray, so mask is built first
+        backgroundThreshold(image, frameBackground(region), gray, 20, m_thresholdValue);
+        medianBlur(gray, binary, 3);
     }
     else
     {
-        frame.copyTo(frameTemp);
-        absdiff(frameTemp,frameBackground, frameTemp);
+        cvtColor(image, gray, COLOR_BGR2GRAY);
+        medianBlur(gray, binary, 3);
+
+        threshold(binary, binary, m_thresholdValue, 255, THRESH_BINARY);
+    }
 
-        frameTemp = myColorThreshold(frameTemp, 20, 255);
+    morphologyEx(binary, binary, MORPH_OPEN , dilateKernel);
 
-        frame.copyTo(frameTemp, frameTemp);
+    //blobs are returned in frame coordinates
+    m_blobExtractor.extract(binary, region.tl(), m_blobs, m_weightedCentroids ? image : Mat(), m_thresholdValue);
+}
+
+void CaptureCamera::GetUndisortedPosition()
+{
+    if(m_undistortMap1.empty())
+    {
+        initUndistortRectifyMap(m_IntrinsicMatrix, m_distortionCoeffs, Mat(), m_IntrinsicMatrix, frame.size(), CV_16SC2, m_undistortMap1, m_undistortMap2);
     }
 
-    cvtColor(frameTemp, frameTemp, COLOR_BGR2GRAY);
-    medianBlur(frameTemp, frameTemp, 3);
+    //maps are computed once, undistort would rebuild them for every frame
+    remap(frame, m_undistorted, m_undistortMap1, m_undistortMap2, INTER_LINEAR);
 
-    threshold(frameTemp,frameTemp, m_thresholdValue, 255, THRESH_BINARY);
+    cv::swap(frame, m_undistorted);
+}
 
-    morphologyEx(frameTemp, frameTemp, MORPH_OPEN , dilateKernel);
+void CaptureCamera::UndistortCentroids()
+{
+    if(m_frameUndistorted || centerOfContour.empty() || m_distortionCoeffs.empty() || m_IntrinsicMatrix.empty())
+    {
+        return;
+    }
 
-    findContours(frameTemp, contours , RETR_EXTERNAL, CHAIN_APPROX_NONE);
+    int centroids = centerOfContour.size();
 
-    for(size_t i = 0; i < contours.size(); i++)
+    //storage only grows, OpenCV gets views of the same size it writes, so it does not reallocate
+    if(m_rawCentroids.cols < centroids)
     {
-        double contArea = contourArea(contours[i]);
+        m_rawCentroids.create(1, centroids, CV_32FC2);
+        m_undistortedCentroids.create(1, centroids, CV_32FC2);
+    }
 
-        if(contArea > 500 || contArea <= 10)
-        {
-            contours.erase(contours.begin()+i);
-        }
+    Mat raw = m_rawCentroids.colRange(0, centroids);
+    Mat undistorted = m_undistortedCentroids.colRange(0, centroids);
+
+    for(int i = 0; i < centroids; i++)
+    {
+        raw.at<Vec2f>(0, i) = Vec2f(centerOfContour[i].x, centerOfContour[i].y);
     }
 
-    drawContours(frame, contours, -1, contourColor , CV_FILLED);
-}
+    //new camera matrix equal to intrinsics keeps result in pixels
+    undistortPoints(raw, undistorted, m_IntrinsicMatrix, m_distortionCoeffs, noArray(), m_IntrinsicMatrix);
 
-void CaptureCamera::GetUndisortedPosition()
-{
-    Mat framein;
+    size_t count = 0;
 
-    frame.copyTo(framein);
+    for(size_t i = 0; i < centerOfContour.size(); i++)
+    {
+        Vec2f point = undistorted.at<Vec2f>(0, i);
 
-    cv::undistort(framein, frame, m_IntrinsicMatrix, m_distortionCoeffs);
+        //full frame remap would cut these away too
+        if(point[0] < 0 || point[1] < 0 || point[0] > frame.cols - 1 || point[1] > frame.rows - 1)
+        {
+            continue;
+        }
+
+        centerOfContour[count++] = vec2(point[0], point[1]);
+    }
+
+    centerOfContour.resize(count);
 }
 
 void CaptureCamera::MiddleOfContours()
 {
     centerOfContour.clear();
 
-    for(size_t i = 0; i < contours.size(); i++)
+    for(size_t i = 0; i < m_blobs.size(); i++)
     {
-        centerMoment = moments(contours[i]);
-        centerTemp = vec2(centerMoment.m10/centerMoment.m00, centerMoment.m01/centerMoment.m00);
+        centerTemp = m_weightedCentroids ? m_blobs[i].weightedCentroid() : m_blobs[i].centroid();
+        centerOfContour.push_back(centerTemp);
 
-        if(!isnan(centerTemp.x) && !isnan(centerTemp.y))
-        {
-            centerOfContour.push_back(centerTemp);
+        circle(frame, cv::Point(centerTemp.x, centerTemp.y), 1, CV_RGB(0,0,255), 2);
+    }
 
-            circle(frame, cv::Point(centerTemp.x, centerTemp.y), 1, CV_RGB(0,0,255), 2);
-        }
+    //tracker works in the same pixels as the filter, before undistortion
+    if(m_tracking)
+    {
+        m_tracker.update(centerOfContour, m_fullScan);
     }
+
+    UndistortCentroids();
 }
 
 void CaptureCamera::CreateLines()
 {
-    lines.clear();
+    lines.resize(0);
+
+    //reflections and lights outside of room never give marker, rays are clipped before pairing
+    bool cull = m_roomDimensions.x > 0 && m_roomDimensions.y > 0 && m_roomDimensions.z > 0;
 
     for(size_t i = 0; i < centerOfContour.size(); i++)
     {
-        lines.push_back({m_globalPosition,m_pixelLines[centerOfContour[i].x][centerOfContour[i].y]});
+        vec3 direction = m_intrinsicRays ? m_pixelToRay * vec3(centerOfContour[i].x, centerOfContour[i].y, 1) : m_rayTable.interpolate(centerOfContour[i]);
+
+        Line line(m_globalPosition, direction);
+
+        if(cull && !Line::ClipToBox(line, vec3(0, 0, 0), m_roomDimensions))
+        {
+            ++m_culledRays;
+            continue;
+        }
+
+        lines.push_back(line);
 
 /*
 
@@ -299,6 +504,59 @@ void CaptureCamera::CreateLines()
 
 }
 
+QVector<Line> CaptureCamera::LinesFromCentroids(const std::vector<vec2> &centroids)
+{
+    centerOfContour = centroids;
+
+    CreateLines();
+
+    return lines;
+}
+
+bool CaptureCamera::ProjectPoint(vec3 point, vec2 &pixel) const
+{
+    if(m_rotationMatrix.empty() || (!m_intrinsicRays && m_anglePerPixel == 0))
+    {
+        return false;
+    }
+
+    //inverse of the model used in CreateLines
+    vec3 v = point - m_globalPosition;
+    vec3 c;
+
+    c.x = m_rotationMatrix.at<float>(0,0) * v.x + m_rotationMatrix.at<float>(0,1) * v.y + m_rotationMatrix.at<float>(0,2) * v.z;
+    c.y = m_rotationMatrix.at<float>(1,0) * v.x + m_rotationMatrix.at<float>(1,1) * v.y + m_rotationMatrix.at<float>(1,2) * v.z;
+    c.z = m_rotationMatrix.at<float>(2,0) * v.x + m_rotationMatrix.at<float>(2,1) * v.y + m_rotationMatrix.at<float>(2,2) * v.z;
+
+    float length = glm::length(c);
+
+    //point behind camera
+    if(length == 0 || c.z >= 0)
+    {
+        return false;
+    }
+
+    if(m_intrinsicRays)
+    {
+        //opencv camera looks along +z with y down
+        float x = c.x / -c.z;
+        float y = c.y / c.z;
+
+        pixel = vec2(m_IntrinsicMatrix.at<float>(0,0) * x + m_IntrinsicMatrix.at<float>(0,1) * y + m_IntrinsicMatrix.at<float>(0,2),
+                     m_IntrinsicMatrix.at<float>(1,1) * y + m_IntrinsicMatrix.at<float>(1,2));
+
+        return pixel.x >= 0 && pixel.y >= 0 && pixel.x < m_resolution.x && pixel.y < m_resolution.y;
+    }
+
+    //angles are in degrees, same as in computeAllDirections
+    double angleY = glm::degrees(asin(-c.y / length));
+    double angleX = glm::degrees(atan2(c.x, -c.z));
+
+    pixel = vec2(angleX / m_anglePerPixel + m_resolution.x/2, angleY / m_anglePerPixel + m_resolution.y/2);
+
+    return pixel.x >= 0 && pixel.y >= 0 && pixel.x < m_resolution.x && pixel.y < m_resolution.y;
+}
+
 void CaptureCamera::ComputeDirVector()
 {
     m_directionVectorToCenter = vec3(m_roomDimensions.x/2 - m_globalPosition.x , m_roomDimensions.y/2 - m_globalPosition.y , m_roomDimensions.z/2 - m_globalPosition.z);
@@ -353,68 +611,105 @@ void CaptureCamera::createExtrinsicMatrix()
 
 void CaptureCamera::computeAllDirections()
 {
-    if(m_anglePerPixel == 0)
-    {
-        m_anglePerPixel = ( (double)  m_fov ) / glm::sqrt( (m_resolution.x * m_resolution.x + m_resolution.y * m_resolution.y));
-    }
-
     std::cout << m_anglePerPixel << std::endl;
 
-    m_pixelLines.clear();
-
-    m_pixelLines.reserve(m_resolution.x);
-    cv::Mat m_invertedRotationMatrix =  m_rotationMatrix.inv();
-
-    QMatrix4x4 rotCamMatrix;
-    QMatrix4x4 rotCamInvertedMatrix;
+    m_rayTable.build(m_resolution.x, m_resolution.y, m_anglePerPixel, m_rotationMatrix, m_directionVectorToCenter);
+}
 
-    for(size_t i = 0; i < 4; i++)
-        for(size_t j = 0; j < 4; j++)
-        {
-            rotCamMatrix(i,j) = m_rotationMatrix.at<float>(i,j);
-            rotCamInvertedMatrix(i,j) = m_invertedRotationMatrix.at<float>(i,j);
-        }
+void CaptureCamera::computeIntrinsicRays()
+{
+    Mat inverse;
+    m_IntrinsicMatrix.convertTo(inverse, CV_64F);
+    inverse = inverse.inv();
 
-    QVector4D vector(m_directionVectorToCenter.x, m_directionVectorToCenter.y, m_directionVectorToCenter.z, 0);
+    double length = glm::length(m_directionVectorToCenter);
 
-    for(size_t i = 0; i < m_resolution.x; i++)
+    //ray = length * R^T * diag(1,-1,-1) * K^-1 * (x, y, 1), rows of R are side, up and backward vector
+    for(int col = 0; col < 3; col++)
     {
-        QVector<glm::vec3> vecTemp;
-        vecTemp.reserve(m_resolution.y);
-
-        for(size_t j = 0; j < m_resolution.y ; j++)
+        for(int row = 0; row < 3; row++)
         {
-            vec2 center = vec2(i,j);
-
-            cv::Point2f centerTemp = cv::Point2f(center.x - m_resolution.x/2,center.y - m_resolution.y/2);
+            double sum = 0;
 
-            QMatrix4x4  rotMatrix;
-            rotMatrix.rotate((-centerTemp.y * m_anglePerPixel), 1,0,0);
+            for(int k = 0; k < 3; k++)
+            {
+                sum += m_rotationMatrix.at<float>(k, row) * (k == 0 ? 1 : -1) * inverse.at<double>(k, col);
+            }
 
-            QMatrix4x4 rotMatrix2;
-            rotMatrix2.rotate((-centerTemp.x * m_anglePerPixel), 0, 1, 0);
+            m_pixelToRay[col][row] = length * sum;
+        }
+    }
+}
 
-            QVector4D result = rotCamInvertedMatrix* rotMatrix2 * rotMatrix * rotCamMatrix * vector;
+QByteArray CaptureCamera::cacheKey() const
+{
+    QCryptographicHash hash(QCryptographicHash::Sha1);
 
-            vec3 final = vec3(result.x(), result.y(), result.z());
+    const float parameters[] = {m_resolution.x, m_resolution.y, m_fov,
+                                m_globalPosition.x, m_globalPosition.y, m_globalPosition.z,
+                                m_roomDimensions.x, m_roomDimensions.y, m_roomDimensions.z};
 
-            vecTemp.append(final);
-        }
+    hash.addData((const char*) parameters, sizeof(parameters));
+    hash.addData((const char*) &m_anglePerPixel, sizeof(m_anglePerPixel));
 
-        m_pixelLines.append(vecTemp);
+    if(!m_IntrinsicMatrix.empty())
+    {
+        Mat intrinsic = m_IntrinsicMatrix.clone();
+        hash.addData((const char*) intrinsic.data, intrinsic.total() * intrinsic.elemSize());
     }
+
+    return hash.result();
 }
 
 void CaptureCamera::computeNewParameters()
 {
     ComputeDirVector();
 
+    if(m_anglePerPixel == 0)
+    {
+        m_anglePerPixel = ( (double)  m_fov ) / glm::sqrt( (m_resolution.x * m_resolution.x + m_resolution.y * m_resolution.y));
+    }
+
+    m_intrinsicRays = m_rayModel == RayModel::INTRINSIC && !m_IntrinsicMatrix.empty();
+
+    QByteArray key;
+
+    //nothing changed since last run, matrices and rays are read from cache
+    if(!m_intrinsicRays)
+    {
+        key = cacheKey();
+
+        if(CameraCache::load(key, m_rotationMatrix, m_CameraMatrix, m_projectionMatrix, m_rayTable))
+        {
+            m_cacheKey = key;
+            return;
+        }
+    }
+
     createExtrinsicMatrix();
 
+    if(!m_IntrinsicMatrix.empty())
+    {
+        m_projectionMatrix = m_IntrinsicMatrix * m_CameraMatrix;
+    }
+
+    //no table is needed, every centroid is back-projected directly
+    if(m_intrinsicRays)
+    {
+        m_rayTable.clear();
+        computeIntrinsicRays();
+        return;
+    }
+
     computeAllDirections();
+
+    if(CameraCache::store(key, m_cacheKey, m_rotationMatrix, m_CameraMatrix, m_projectionMatrix, m_rayTable))
+    {
+        m_cacheKey = key;
+    }
 }
 
-cv::Mat CaptureCamera::myColorThreshold(cv::Mat input , int thresholdValue, int maxValue)
+void CaptureCamera::myColorThreshold(const Mat &input, Mat &output, int thresholdValue, int maxValue)
 {
 /*
     std::vector<Mat> ChannelsFrameTemp;
@@ -431,11 +726,9 @@ cv::Mat CaptureCamera::myColorThreshold(cv::Mat input , int thresholdValue, int
 
     morphologyEx(input, input, MORPH_OPEN , dilateKernel);// , Point(-1,-1),  5);*/
 
-    cvtColor(input, input, COLOR_BGR2GRAY);
-
-    threshold(input, input, thresholdValue, maxValue, THRESH_BINARY);
+    cvtColor(input, output, COLOR_BGR2GRAY);
 
-    return input;
+    threshold(output, output, thresholdValue, maxValue, THRESH_BINARY);
 }
 
 void CaptureCamera::activeCam(bool active)
@@ -472,7 +765,7 @@ void CaptureCamera::TurnOn()
     if(m_turnedOn)
         return;
 
-    if(camera.open(m_videoUsbId))
+    if(m_frameSource->open())
     {
         //QtWidgetViewer->setCheckTurnedOn(true);
         m_turnedOn = true;
@@ -490,10 +783,24 @@ void CaptureCamera::TurnOn()
 
         if(m_resolution.x != 0 && m_resolution.y !=0)
         {
-            camera.set(CV_CAP_PROP_FRAME_WIDTH, m_resolution.x);
-            camera.set(CV_CAP_PROP_FRAME_HEIGHT, m_resolution.y);
+            m_frameSource->setResolution(m_resolution.x, m_resolution.y);
+        }
+
+    if(m_turnedOn)
+    {
+        if(m_resolution.x != 0 && m_resolution.y !=0)
+        {
+            m_frameBuffer.allocate(m_resolution.y, m_resolution.x, CV_8UC3);
+            AllocateWorkspace(m_resolution.y, m_resolution.x);
         }
 
+        m_frameBuffer.clear();
+        m_tracker.reset();
+
+        m_grabThread = new GrabThread(m_frameSource, &m_frameBuffer);
+        m_grabThread->start();
+    }
+
 }
 
 void CaptureCamera::TurnOff()
@@ -502,7 +809,13 @@ void CaptureCamera::TurnOff()
     {
         m_turnedOn = false;
         m_QtWidgetViewer->setCheckTurnedOn(false);
-        camera.release();
+
+        m_grabThread->stop();
+        delete m_grabThread;
+        m_grabThread = nullptr;
+
+        //frame counters stay readable until next TurnOn, image benchmark reports them
+        m_frameSource->release();
     }
 
 }
@@ -533,51 +846,85 @@ void CaptureCamera::CalibNoMarkers()
         int i = 0, maxIters = 10;
         Scalar meanValue, lastMeanValue;
 
-        camera >> frameBackground;
-        waitKey(33);
-
-        lastMeanValue = mean(frameBackground);
+        //GrabFrame waits for next frame, no sleeps are needed
+        GrabFrame(frame);
+        lastMeanValue = mean(frame);
 
-        camera >> frameBackground;
-        waitKey(33);
-
-        meanValue = mean(frameBackground);
+        GrabFrame(frame);
+        meanValue = mean(frame);
 
         while(i < maxIters && ( abs( lastMeanValue.val[0] - meanValue.val[0] ) > 1 || abs( lastMeanValue.val[1] - meanValue.val[1] ) > 1 || abs( lastMeanValue.val[2] - meanValue.val[2] ) > 1 ) )
         {
-            camera >> frameBackground;
+            GrabFrame(frame);
             lastMeanValue = meanValue;
-            meanValue  = mean(frameBackground);
+            meanValue  = mean(frame);
             ++i;
-            waitKey(66);
         }
 
         std::cout << m_name.toStdString() << " calibrated in " << i << " iterations" << std::endl;
 
-        Mat temp;
+        m_backgroundModel.reset();
+
+        //MOG needs more frames to learn than background model
+        size_t frames = useBackgroundSub ? 50 : 15;
 
-        for(size_t i = 0; i < 50; i++)
+        for(size_t i = 0; i < frames; i++)
         {
-            camera >> temp;
-            backgroundExtractor->operator ()(frame, MOGMask);
+            if(!GrabFrame(frame))
+            {
+                continue;
+            }
+
+            if(useBackgroundSub)
+            {
+                backgroundExtractor->operator ()(frame, MOGMask);
+            }
 
             if(i < 15)
             {
-                for(int i = 0; i < temp.rows; i++)
-                {
-                    for(int j = 0; j < temp.cols; j++)
-                    {
-                        if(temp.at<Vec3b>(i,j)[0] > frameBackground.at<Vec3b>(i,j)[0] || temp.at<Vec3b>(i,j)[1] > frameBackground.at<Vec3b>(i,j)[1] || temp.at<Vec3b>(i,j)[2] > frameBackground.at<Vec3b>(i,j)[2])
-                        {
-                            frameBackground.at<Vec3b>(i,j) = temp.at<Vec3b>(i,j);
-                        }
-                    }
-                }
+                m_backgroundModel.add(frame);
             }
+        }
+
+        //shares data with model, so drift refresh is visible to filter
+        frameBackground = m_backgroundModel.background();
+    }
+}
 
-            waitKey(20);
+void CaptureCamera::CalibrationImage(Mat &gray)
+{
+    //median and opening commute with threshold, so blobs of this image above t are blobs of filter with threshold t
+    if(useBackgroundSub)
+    {
+        frameTemp.create(frame.size(), frame.type());
+        frameTemp.setTo(Scalar::all(0));
+        backgroundExtractor->operator ()(frame, MOGMask);
+        frame.copyTo(frameTemp, MOGMask);
+
+        cvtColor(frameTemp, gray, COLOR_BGR2GRAY);
+    }
+    else
+    {
+        cvtColor(frame, gray, COLOR_BGR2GRAY);
+
+        if(!frameBackground.empty())
+        {
+            //threshold -1 leaves only difference from background
+            backgroundThreshold(frame, frameBackground, m_binary, 20, -1);
+            gray.setTo(Scalar::all(0), m_binary == 0);
         }
     }
+
+    if(ROI)
+    {
+        gray.setTo(Scalar::all(0), m_ROIInverse);
+    }
+
+    if(m_detector == DetectorMode::MASK || useBackgroundSub)
+    {
+        medianBlur(gray, m_binary, 3);
+        morphologyEx(m_binary, gray, MORPH_OPEN , dilateKernel);
+    }
 }
 
 int CaptureCamera::CalibWithMarkers(int numOfMarkers)
@@ -586,78 +933,54 @@ int CaptureCamera::CalibWithMarkers(int numOfMarkers)
 
     if(m_turnedOn)
     {
-
-        size_t thresholdUp, thresholdLow;
-
+        //let exposure settle
         for(size_t i = 0; i < 15; i++)
         {
-            camera >> frame;
-            waitKey(10);
+            GrabFrame(frame);
         }
 
-        size_t nLines;
+        Mat gray;
+        std::vector<int> counts;
 
-        //step 1, find first value which gives some Lines
-        while(m_thresholdValue > 20)
-        {
-            UseFilter();
-            MiddleOfContours();
-            CreateLines();
+        CalibrationImage(gray);
+        m_blobExtractor.countPerThreshold(gray, counts);
 
-            if(lines.size() == 0)
-            {
-                --m_thresholdValue;
-                continue;
-            }
-            else
+        int threshold = 255;
+
+        //step 1, find first value which gives some blobs
+        while(threshold > 20)
+        {
+            if(counts[threshold] != 0 && (numOfMarkers == 0 || counts[threshold] == numOfMarkers))
             {
-                if(numOfMarkers == 0)
-                {
-                    break;
-                }
-                else
-                {
-                    if(lines.size() == numOfMarkers)
-                    {
-                        break;
-                    }
-                }
+                break;
             }
+
+            --threshold;
         }
 
         //some difference in light intensity (rotation of LED)
-        m_thresholdValue -= 10;
-
-        UseFilter();
-        MiddleOfContours();
-        CreateLines();
+        threshold -= 10;
 
-        nLines = lines.size();
+        int nBlobs = counts[threshold];
+        int thresholdUp = threshold;
+        int thresholdLow = 0;
 
-        thresholdUp = m_thresholdValue;
-        thresholdLow = 0;
         std::cout << "calibrated upper value" << thresholdUp << std::endl;
 
-        //step 2 , find threshold where num of lines is starting to grow
-        while(m_thresholdValue > 0)
+        //step 2 , find threshold where num of blobs is starting to grow
+        while(threshold > 0)
         {
-            --m_thresholdValue;
+            --threshold;
 
-            UseFilter();
-            MiddleOfContours();
-            CreateLines();
-
-            if(nLines < lines.size())
+            if(nBlobs < counts[threshold])
             {
-                thresholdLow = m_thresholdValue;
+                thresholdLow = threshold;
                 std::cout << "distance: " << "calibrated lower value" << thresholdLow << std::endl;
                 break;
             }
         }
 
         m_thresholdValue = thresholdLow + (thresholdUp + thresholdLow)/8;
-
-        m_QtWidgetViewer->setThreshold(m_thresholdValue);
     }
 
     return m_thresholdValue;
@@ -680,6 +1003,57 @@ const QString roineededKey("roineeded");
 const QString useBackgroundSubstractorKey("backgroundSubstractor");
 const QString resolutionKeyX("resolutionX");
 const QString resolutionKeyY("resolutionY");
+const QString undistortCentroidsKey("undistortCentroids");
+const QString trackingKey("tracking");
+const QString trackingWindowKey("trackingWindow");
+const QString fullScanIntervalKey("fullScanInterval");
+const QString minBlobAreaKey("minBlobArea");
+const QString weightedCentroidsKey("weightedCentroids");
+const QString detectorKey("detector");
+const QString backgroundModelKey("backgroundModel");
+const QString previewFpsKey("previewFps");
+const QString backgroundRefreshKey("backgroundRefresh");
+const QString backgroundDriftKey("backgroundDriftShift");
+const QString maxBlobAreaKey("maxBlobArea");
+const QString maxBlobsKey("maxBlobs");
+const QString rayModelKey("rayModel");
+const QString cameraMatrixKey("cameraMatrix");
+const QString distortionCoeffsKey("distortionCoeffs");
+
+static QVariantList matrixToVariant(const Mat &matrix)
+{
+    QVariantList retVal;
+    Mat values;
+    matrix.convertTo(values, CV_64F);
+
+    for(int i = 0; i < values.rows; i++)
+    {
+        for(int j = 0; j < values.cols; j++)
+        {
+            retVal.append(values.at<double>(i,j));
+        }
+    }
+
+    return retVal;
+}
+
+/// empty matrix if list does not fit, cols = 0 takes whole list as one row
+static Mat variantToMatrix(const QVariantList &list, int rows, int cols)
+{
+    if(list.isEmpty() || (cols != 0 && list.size() != rows * cols))
+    {
+        return Mat();
+    }
+
+    Mat retVal(rows, cols ? cols : list.size(), CV_64F);
+
+    for(int i = 0; i < list.size(); i++)
+    {
+        retVal.at<double>(i / retVal.cols, i % retVal.cols) = list[i].toDouble();
+    }
+
+    return retVal;
+}
 
 QVariantMap CaptureCamera::toVariantMap()
 {
@@ -702,6 +1076,37 @@ QVariantMap CaptureCamera::toVariantMap()
     retVal[useBackgroundSubstractorKey] = useBackgroundSub;
     retVal[resolutionKeyX] = m_resolution.x;
     retVal[resolutionKeyY] = m_resolution.y;
+    retVal[undistortCentroidsKey] = m_undistortCentroids;
+    retVal[trackingKey] = m_tracking;
+    retVal[trackingWindowKey] = m_tracker.windowRadius();
+    retVal[fullScanIntervalKey] = (int) m_tracker.fullScanInterval();
+    retVal[minBlobAreaKey] = m_blobExtractor.minArea();
+    retVal[weightedCentroidsKey] = m_weightedCentroids;
+    retVal[detectorKey] = m_detector == DetectorMode::RUNLENGTH ? "runlength" : "mask";
+    retVal[backgroundModelKey] = m_backgroundModel.mode() == BackgroundMode::AVERAGE ? "average" : "max";
+    retVal[backgroundRefreshKey] = m_backgroundRefresh;
+    retVal[previewFpsKey] = m_QtWidgetViewer->getImageViewer()->displayRate();
+    retVal[backgroundDriftKey] = m_backgroundModel.driftShift();
+    retVal[maxBlobAreaKey] = m_blobExtractor.maxArea();
+    retVal[maxBlobsKey] = m_maxBlobs;
+    retVal[rayModelKey] = m_rayModel == RayModel::INTRINSIC ? "intrinsic" : "angle";
+
+    if(!m_IntrinsicMatrix.empty())
+    {
+        retVal[cameraMatrixKey] = matrixToVariant(m_IntrinsicMatrix);
+    }
+
+    if(!m_distortionCoeffs.empty())
+    {
+        retVal[distortionCoeffsKey] = matrixToVariant(m_distortionCoeffs);
+    }
+
+    QVariantMap source = m_frameSource->toVariantMap();
+
+    for(auto it = source.begin(); it != source.end(); ++it)
+    {
+        retVal[it.key()] = it.value();
+    }
 
     return retVal;
 }
@@ -714,6 +1119,23 @@ void CaptureCamera::fromVariantMap(QVariantMap varMap)
     m_fov = varMap[fovKey].toFloat();
     m_roomDimensions = vec3(varMap[roomDimensionsKeyX].toFloat(), varMap[roomDimensionsKeyY].toFloat(), varMap[roomDimensionsKeyZ].toFloat());
     m_resolution =  vec2(varMap[resolutionKeyX].toFloat(), varMap[resolutionKeyY].toFloat());
+    m_undistortCentroids = varMap.value(undistortCentroidsKey, true).toBool();
+    m_tracking = varMap.value(trackingKey, false).toBool();
+    m_tracker.setWindowRadius(varMap.value(trackingWindowKey, 24).toInt());
+    m_tracker.setFullScanInterval(varMap.value(fullScanIntervalKey, 30).toInt());
+    setBlobAreaLimits(varMap.value(minBlobAreaKey, 10).toInt(), varMap.value(maxBlobAreaKey, 500).toInt());
+    m_maxBlobs = std::max(varMap.value(maxBlobsKey, 64).toInt(), 1);
+    m_detector = varMap.value(detectorKey).toString() == "runlength" ? DetectorMode::RUNLENGTH : DetectorMode::MASK;
+    m_backgroundModel.setMode(varMap.value(backgroundModelKey).toString() == "average" ? BackgroundMode::AVERAGE : BackgroundMode::MAX);
+    m_backgroundRefresh = varMap.value(backgroundRefreshKey, false).toBool();
+    m_backgroundModel.setDriftShift(varMap.value(backgroundDriftKey, 6).toInt());
+    m_weightedCentroids = varMap.value(weightedCentroidsKey, false).toBool();
+    m_rayModel = varMap.value(rayModelKey).toString() == "intrinsic" ? RayModel::INTRINSIC : RayModel::ANGLE;
+    variantToMatrix(varMap.value(cameraMatrixKey).toList(), 3, 3).convertTo(m_IntrinsicMatrix, CV_32F);
+    m_distortionCoeffs = variantToMatrix(varMap.value(distortionCoeffsKey).toList(), 1, 0);
+
+    delete m_frameSource;
+    m_frameSource = FrameSource::fromVariantMap(varMap, m_videoUsbId);
 
     computeNewParameters();
 
@@ -725,8 +1147,7 @@ void CaptureCamera::fromVariantMap(QVariantMap varMap)
     useBackgroundSub = varMap[useBackgroundSubstractorKey].toFloat();
 
     m_QtWidgetViewer = new CamWidget;
-    CQtOpenCVViewerGl *t = m_QtWidgetViewer->getImageViewer();
-    connect(this, SIGNAL(imageRead(cv::Mat)), t, SLOT(showImage(cv::Mat)));
+    m_QtWidgetViewer->getImageViewer()->setDisplayRate(varMap.value(previewFpsKey, 30).toInt());
     connect(m_QtWidgetViewer, SIGNAL(activeCam(bool)), this, SLOT(activeCam(bool)));
     connect(m_QtWidgetViewer, SIGNAL(turnedOnCam(bool)), this, SLOT(turnedOnCam(bool)));
     connect(m_QtWidgetViewer, SIGNAL(thresholdCam(size_t)), this, SLOT(thresholdCam(size_t)));
@@ -24,6 +24,11 @@
 #define CAPTURECAMERA_H
 
 #include "line.h"
+#include "grabthread.h"
+#include "blobtracker.h"
+#include "runlengthdetector.h"
+#include "backgroundmodel.h"
+#include "pixelraytable.h"
 #include "Gui/camwidget.h"
 
 #include <fstream>
@@ -31,12 +36,16 @@
 #include <opencv2/highgui/highgui.hpp>
 #include <opencv2/opencv.hpp>
 
+/// MASK filters whole image and labels binary mask, RUNLENGTH thresholds rows into runs
+enum class DetectorMode {MASK, RUNLENGTH};
+
+/// ANGLE rotates center ray by fixed angle per pixel (table of rays), INTRINSIC back-projects centroid by inverse camera matrix
+enum class RayModel {ANGLE, INTRINSIC};
+
 class CaptureCamera: public QObject
 {
     Q_OBJECT
 
-    typedef std::vector<cv::Point> Contour;
-
     //BASIC PARAMETERS
     int m_videoUsbId = 0;
     QString m_name = "Camera";
@@ -60,12 +69,38 @@ class CaptureCamera: public QObject
     CamWidget * m_QtWidgetViewer = nullptr;
 
     //ADVANCED for camera
-    cv::VideoCapture camera;
+    FrameSource *m_frameSource = nullptr;
+    FrameRingBuffer m_frameBuffer;
+    GrabThread *m_grabThread = nullptr;
+    qint64 m_frameTimestamp = 0;
     bool ROI = false;
     cv::Mat ROIMask;
     cv::Mat frameBackground ,frame, frameTemp;
 
+    //persistent workspace of image pipeline, sized in TurnOn
+    cv::Mat m_undistorted, m_undistortMap1, m_undistortMap2;
+    cv::Mat m_rawCentroids, m_undistortedCentroids;
+    bool m_undistortCentroids = true;
+    bool m_frameUndistorted = false;
+    cv::Mat m_gray, m_binary, m_ROIInverse;
+
+    //heap allocations of capture thread from one UseFilter to the next, build with WEBCAMCAP_COUNT_ALLOCATIONS
+    static const size_t allocationWarmUpFrames = 10;
+    size_t m_allocationFrames = 0;
+    size_t m_allocatingFrames = 0;
+    size_t m_steadyAllocations = 0;
+    size_t m_allocationMark = 0;
+
+    //predictive tracking, only windows around predicted blobs are processed
+    bool m_tracking = false;
+    bool m_fullScan = true;
+    BlobTracker m_tracker;
+    std::vector<cv::Rect> m_trackingWindows;
+
     //background substract
+    BackgroundModel m_backgroundModel;
+    bool m_backgroundRefresh = false;
+    std::vector<cv::Rect> m_foregroundRects;
     bool useBackgroundSub;
     cv::Mat MOGMask;
     cv::BackgroundSubtractorMOG* backgroundExtractor;
@@ -73,21 +108,31 @@ class CaptureCamera: public QObject
     //ADVANCED for image process
     cv::Mat dilateKernel = cv::getStructuringElement(cv::MORPH_ELLIPSE, cv::Size(3,3));
     cv::Scalar contourColor;
-    std::vector <Contour> contours;
-    cv::Moments centerMoment;
+    BlobExtractor m_blobExtractor;
+    std::vector<Blob> m_blobs;
+    bool m_weightedCentroids = false;
+    DetectorMode m_detector = DetectorMode::MASK;
+    RunLengthDetector m_runLengthDetector;
+    int m_maxBlobs = 64;        /// rays handed to fusion per frame, more are counted as truncated
     glm::vec2 centerTemp;
     cv::Point2f  centerRelativeTemp;
     std::vector<glm::vec2> centerOfContour;
 
     glm::vec3 directionTemp;
     QVector<Line> lines;
+    size_t m_culledRays = 0;    /// rays missing the room, since start
 
     //all matrices
     cv::Mat m_projectionMatrix;
     cv::Mat m_CameraMatrix;
     cv::Mat m_IntrinsicMatrix;
 
-    QVector<QVector<glm::vec3>> m_pixelLines; // reserver , squeeze
+    PixelRayTable m_rayTable;
+    QByteArray m_cacheKey;          /// file in CameraCache the table came from
+
+    RayModel m_rayModel = RayModel::ANGLE;
+    bool m_intrinsicRays = false;   /// INTRINSIC model with known camera matrix is in use
+    glm::mat3 m_pixelToRay;         /// homogeneous undistorted pixel to world ray
 
 public:
     //public parameters
@@ -99,7 +144,8 @@ public:
 
     ~CaptureCamera();
 
-    QVector<Line> RecordNextFrame();
+    /// lines stay valid until next frame, capture thread copies them without sharing
+    const QVector<Line> &RecordNextFrame();
     std::vector<glm::vec2> RecordNextFrame2D();
     void TurnOn();
     void TurnOff();
@@ -107,14 +153,27 @@ public:
     void Hide();
     void Save(std::ofstream &outputFile);
     void CalibNoMarkers();
+    /// threshold for markers from one frame, safe to run for cameras in parallel, widget is not updated
     int CalibWithMarkers(int numOfMarkers);
-    void setROI(cv::Mat roi){ROIMask = roi; ROI = true;}
+    void setROI(cv::Mat roi){ROIMask = roi; m_ROIInverse = (roi == 0); ROI = true;}
+
+    QVector<Line> LinesFromCentroids(const std::vector<glm::vec2> &centroids);
+    bool ProjectPoint(glm::vec3 point, glm::vec2 &pixel) const;
 
     void setPosition(glm::vec3 position){m_globalPosition = position; computeNewParameters();}
     void setDimensions(glm::vec3 roomDim){m_roomDimensions = roomDim; computeNewParameters();}
     void setThreshold(size_t Threshold){m_thresholdValue = Threshold;}
     void setAngle(float Angle){m_fov = Angle; m_anglePerPixel = 0;}
     void setName(QString name){m_name = name;}
+    void setUndistortCentroids(bool centroids){m_undistortCentroids = centroids;}
+    void setTracking(bool tracking){m_tracking = tracking; m_tracker.reset();}
+    void setBlobAreaLimits(int minArea, int maxArea){m_blobExtractor.setAreaLimits(minArea, maxArea); m_runLengthDetector.setAreaLimits(minArea, maxArea);}
+    void setWeightedCentroids(bool weighted){m_weightedCentroids = weighted;}
+    void setDetector(DetectorMode detector){m_detector = detector;}
+    void setRayModel(RayModel model){m_rayModel = model; computeNewParameters();}
+    void setBackgroundRefresh(bool refresh){m_backgroundRefresh = refresh;}
+    BackgroundModel &backgroundModel() {return m_backgroundModel;}
+    void setFrameSource(FrameSource *source);
 
 
     QString getName() const {return m_name;}
@@ -123,9 +182,32 @@ public:
     int getID() const {return m_videoUsbId;}
     float getAngle() const {return m_fov;}
     bool getTurnedOn() const {return m_turnedOn;}
+    bool getUndistortCentroids() const {return m_undistortCentroids;}
+    bool getTracking() const {return m_tracking;}
+    bool getWeightedCentroids() const {return m_weightedCentroids;}
+    DetectorMode getDetector() const {return m_detector;}
+    RayModel getRayModel() const {return m_rayModel;}
+    BlobTracker &tracker() {return m_tracker;}
     CamWidget *getWidget() const {return m_QtWidgetViewer;}
-
-    static cv::Mat myColorThreshold(cv::Mat input, int m_thresholdValue, int maxValue);
+    FrameSource *getFrameSource() const {return m_frameSource;}
+    qint64 frameTimestamp() const {return m_frameTimestamp;}
+    size_t grabbedFrames() const {return m_frameBuffer.grabbed();}
+    size_t processedFrames() const {return m_frameBuffer.processed();}
+    size_t droppedFrames() const {return m_frameBuffer.dropped();}
+    /**
+     * heap allocations of frames after warm-up since TurnOn, zero when pipeline runs in place,
+     * counted only when AllocationCounter is enabled
+     *
+     * Known exceptions: morphologyEx of mask detector (OpenCV creates filter engine per call),
+     * MOG background subtractor, growth of blob and centroid storage when more markers appear,
+     * events posted to capture thread and handled by its processEvents.
+     */
+    size_t steadyAllocations() const {return m_steadyAllocations;}
+    size_t allocatingFrames() const {return m_allocatingFrames;}
+    size_t culledRays() const {return m_culledRays;}
+    int maxBlobs() const {return m_maxBlobs;}
+
+    static void myColorThreshold(const cv::Mat &input, cv::Mat &output, int m_thresholdValue, int maxValue);
 
     cv::Mat distortionCoeffs() const;
     void setDistortionCoeffs(const cv::Mat &distortionCoeffs);
@@ -151,8 +233,14 @@ public slots:
 
 private:
     
+    bool GrabFrame(cv::Mat &image);
+    void AllocateWorkspace(int rows, int cols);
+    void CountAllocations();
     void GetUndisortedPosition();
+    void UndistortCentroids();
+    void CalibrationImage(cv::Mat &gray);
     void UseFilter();
+    void FilterRegion(const cv::Rect &region);
     void MiddleOfContours();
     void CreateLines();
     void ComputeDirVector();
@@ -160,11 +248,12 @@ private:
     void createExtrinsicMatrix();
 
     void computeAllDirections();
+    void computeIntrinsicRays();
 
-    void computeNewParameters();
+    /// hash of everything derived matrices and rays depend on, names file in CameraCache
+    QByteArray cacheKey() const;
 
-signals:
-    void imageRead(cv::Mat image);
+    void computeNewParameters();
 
 };
 
@@ -22,15 +22,17 @@
 
 #include "capturethread.h"
 
+#include <algorithm>
+
 using glm::vec2;
 using glm::vec3;
 
-worker::worker(QWaitCondition *q, CaptureCamera *cam, QObject *parent) :
+worker::worker(CaptureCamera *cam, ObservationQueue *queue, QObject *parent) :
   QObject(parent)
 {
     running = false;
-    line = q;
     this->cam = cam;
+    m_queue = queue;
 }
 
 void worker::do_Work()
@@ -44,15 +46,34 @@ void worker::do_Work()
           break;
       }
 
-      result = cam->RecordNextFrame();
+      mutex.unlock();
+
+      if(!cam->getTurnedOn())
+      {
+          QThread::msleep(10);
+          QCoreApplication::processEvents();
+          continue;
+      }
 
-      emit ResultReady(result);
+      //reference, a shared copy would make camera detach its lines every frame
+      const QVector<Line> &result = cam->RecordNextFrame();
 
-      if(!line->wait(&mutex,1000))
+      //cameras run freely, fusion thread of Room groups observations by their capture time
+      if(cam->frameTimestamp() != lastTimestamp)
       {
-         qDebug() << "signal lost";
+          lastTimestamp = cam->frameTimestamp();
+
+          //full ring means fusion is behind, the observation is counted by the ring and lost
+          if(ObservationRecord *record = m_queue->beginPush())
+          {
+              record->m_timestamp = lastTimestamp;
+              record->m_count = std::min(result.size(), (int) record->m_lines.size());
+              record->m_truncated = result.size() - record->m_count;
+              std::copy(result.begin(), result.begin() + record->m_count, record->m_lines.begin());
+
+              m_queue->commitPush();
+          }
       }
-      mutex.unlock();
 
       QCoreApplication::processEvents();
   }
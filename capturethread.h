@@ -28,6 +28,7 @@
 
 #include "openglwindow.h"
 #include "capturecamera.h"
+#include "frameassembler.h"
 
 #include <QtCore>
 #include <QTime>
@@ -41,17 +42,17 @@ class worker : public QObject
 
     CaptureCamera *cam;
     QMutex mutex;
-    QWaitCondition *line;
 
-    QVector<Line> result;
+    qint64 lastTimestamp = 0;
+
+    ObservationQueue *m_queue;  //this worker is the only producer
 
 public:
-    explicit worker(QWaitCondition *q, CaptureCamera *cam,QObject *parent = 0);
+    explicit worker(CaptureCamera *cam, ObservationQueue *queue, QObject *parent = 0);
     ~worker(){do_Work(); emit finished();}
 
 signals:
     void finished();
-    void ResultReady(QVector<Line> points2D);
 
 public slots:
   void StopWork();
@@ -0,0 +1,121 @@
+/*
+ *
+ * Copyright (C) 2014  Miroslav Krajicek, Faculty of Informatics Masaryk University (https://github.com/kaajo).
+ * All Rights Reserved.
+ *
+ * This file is part of WebCamCap.
+ *
+ * WebCamCap is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU LGPL version 3 as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WebCamCap is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU LGPL version 3
+ * along with WebCamCap. If not, see <http://www.gnu.org/licenses/lgpl-3.0.txt>.
+ *
+ */
+
+#include "componentlabels.h"
+
+void ComponentLabels::clear()
+{
+    m_parent.assign(1, 0);
+    m_components.resize(1);
+}
+
+int ComponentLabels::newLabel(int x, int y)
+{
+    int label = m_parent.size();
+
+    m_parent.push_back(label);
+    m_components.push_back({0, x, y, x, y, 0, 0, 0, 0, 0});
+
+    return label;
+}
+
+int ComponentLabels::find(int label)
+{
+    while(m_parent[label] != label)
+    {
+        //path halving
+        m_parent[label] = m_parent[m_parent[label]];
+        label = m_parent[label];
+    }
+
+    return label;
+}
+
+int ComponentLabels::unite(int a, int b)
+{
+    a = find(a);
+    b = find(b);
+
+    //smaller label is root
+    if(a < b)
+    {
+        m_parent[b] = a;
+        return a;
+    }
+
+    m_parent[a] = b;
+    return b;
+}
+
+void ComponentLabels::blobs(int minArea, int maxArea, cv::Point offset, std::vector<Blob> &blobs)
+{
+    //statistics of every provisional label are added to its final root once, image is not scanned again
+    for(size_t label = m_components.size() - 1; label > 0; label--)
+    {
+        int root = find(label);
+
+        if(root == (int) label)
+        {
+            continue;
+        }
+
+        Component &c = m_components[label];
+        Component &r = m_components[root];
+
+        r.m_area += c.m_area;
+        r.m_sumX += c.m_sumX;
+        r.m_sumY += c.m_sumY;
+        r.m_weight += c.m_weight;
+        r.m_weightedSumX += c.m_weightedSumX;
+        r.m_weightedSumY += c.m_weightedSumY;
+        r.m_minX = std::min(r.m_minX, c.m_minX);
+        r.m_minY = std::min(r.m_minY, c.m_minY);
+        r.m_maxX = std::max(r.m_maxX, c.m_maxX);
+        r.m_maxY = std::max(r.m_maxY, c.m_maxY);
+    }
+
+    for(size_t label = 1; label < m_components.size(); label++)
+    {
+        const Component &c = m_components[label];
+
+        if(m_parent[label] != (int) label || c.m_area < minArea || c.m_area > maxArea)
+        {
+            continue;
+        }
+
+        Blob blob;
+        blob.m_area = c.m_area;
+        blob.m_boundingBox = cv::Rect(c.m_minX + offset.x, c.m_minY + offset.y, c.m_maxX - c.m_minX + 1, c.m_maxY - c.m_minY + 1);
+        blob.m_m10 = c.m_sumX + (double) offset.x * c.m_area;
+        blob.m_m01 = c.m_sumY + (double) offset.y * c.m_area;
+        blob.m_weight = c.m_weight;
+        blob.m_weightedM10 = c.m_weightedSumX + (double) offset.x * c.m_weight;
+        blob.m_weightedM01 = c.m_weightedSumY + (double) offset.y * c.m_weight;
+
+        blobs.push_back(blob);
+    }
+}
+
+size_t ComponentLabels::capacity() const
+{
+    return m_parent.capacity() * sizeof(int) + m_components.capacity() * sizeof(Component);
+}
@@ -0,0 +1,124 @@
+/*
+ *
+ * Copyright (C) 2014  Miroslav Krajicek, Faculty of Informatics Masaryk University (https://github.com/kaajo).
+ * All Rights Reserved.
+ *
+ * This file is part of WebCamCap.
+ *
+ * WebCamCap is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU LGPL version 3 as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WebCamCap is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU LGPL version 3
+ * along with WebCamCap. If not, see <http://www.gnu.org/licenses/lgpl-3.0.txt>.
+ *
+ */
+
+#ifndef COMPONENTLABELS_H
+#define COMPONENTLABELS_H
+
+#include <algorithm>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <opencv2/core/core.hpp>
+
+class Blob
+{
+public:
+    int m_area = 0;
+    cv::Rect m_boundingBox;
+
+    //first order moments of pixel centers
+    double m_m10 = 0;
+    double m_m01 = 0;
+
+    //moments weighted by gray level above threshold, zero if not requested
+    double m_weight = 0;
+    double m_weightedM10 = 0;
+    double m_weightedM01 = 0;
+
+    glm::vec2 centroid() const {return glm::vec2(m_m10 / m_area, m_m01 / m_area);}
+
+    /// subpixel center of bright marker, binary centroid if no weights were collected
+    glm::vec2 weightedCentroid() const {return m_weight > 0 ? glm::vec2(m_weightedM10 / m_weight, m_weightedM01 / m_weight) : centroid();}
+};
+
+/**
+ * @brief provisional labels of one raster pass joined by union-find, statistics are accumulated per label
+ *
+ * Rows have to be added from top to bottom. Statistics of joined labels are merged to roots only in blobs(),
+ * so the image is read once. Label 0 is background.
+ */
+class ComponentLabels
+{
+    class Component
+    {
+    public:
+        int m_area;
+        int m_minX, m_minY, m_maxX, m_maxY;
+        long long m_sumX, m_sumY;
+        long long m_weight, m_weightedSumX, m_weightedSumY;
+    };
+
+    std::vector<int> m_parent;
+    std::vector<Component> m_components;
+
+public:
+    /// removes all labels, buffers are kept
+    void clear();
+
+    /// label of new component touching pixel x, y, statistics are empty
+    int newLabel(int x, int y);
+    int find(int label);
+    /// joins components of both labels, returns root
+    int unite(int a, int b);
+
+    void addPixel(int label, int x, int y)
+    {
+        Component &c = m_components[label];
+        ++c.m_area;
+        c.m_sumX += x;
+        c.m_sumY += y;
+        c.m_minX = std::min(c.m_minX, x);
+        c.m_maxX = std::max(c.m_maxX, x);
+        c.m_maxY = y;
+    }
+
+    /// pixels start..end of row y
+    void addRun(int label, int start, int end, int y)
+    {
+        int length = end - start + 1;
+
+        Component &c = m_components[label];
+        c.m_area += length;
+        c.m_sumX += (long long) (start + end) * length / 2;
+        c.m_sumY += (long long) y * length;
+        c.m_minX = std::min(c.m_minX, start);
+        c.m_maxX = std::max(c.m_maxX, end);
+        c.m_maxY = y;
+    }
+
+    /// gray level weights of pixels in row y, weightedSumX is sum of weight * x
+    void addWeight(int label, long long weight, long long weightedSumX, int y)
+    {
+        Component &c = m_components[label];
+        c.m_weight += weight;
+        c.m_weightedSumX += weightedSumX;
+        c.m_weightedSumY += weight * y;
+    }
+
+    /// merges statistics to roots and appends components with area in <minArea, maxArea>, offset is added to coordinates
+    void blobs(int minArea, int maxArea, cv::Point offset, std::vector<Blob> &blobs);
+
+    /// bytes reserved by internal buffers
+    size_t capacity() const;
+};
+
+#endif // COMPONENTLABELS_H
@@ -0,0 +1,87 @@
+/*
+ *
+ * Copyright (C) 2014  Miroslav Krajicek, Faculty of Informatics Masaryk University (https://github.com/kaajo).
+ * All Rights Reserved.
+ *
+ * This file is part of WebCamCap.
+ *
+ * WebCamCap is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU LGPL version 3 as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WebCamCap is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU LGPL version 3
+ * along with WebCamCap. If not, see <http://www.gnu.org/licenses/lgpl-3.0.txt>.
+ *
+ */
+
+#include "epipolargeometry.h"
+
+#include <cmath>
+
+using glm::vec3;
+
+constexpr float EpipolarGeometry::nearBaselineAngle;
+
+void EpipolarGeometry::set(vec3 position1, vec3 position2, float tolerance, float maxError)
+{
+    m_tolerance = glm::radians(tolerance);
+    m_baseline = position2 - position1;
+
+    float length = glm::length(m_baseline);
+
+    //pairs meeting farther than r0 from baseline are in band, 1% covers rounding of angles
+    double r0 = m_tolerance > 0 && m_tolerance < CV_PI / 2 ? maxError / std::sin(m_tolerance) : 0;
+    m_nearSine = length > maxError ? 1.01 * 2 * (r0 + maxError) / (length - maxError) : 1;
+
+    //rays near baseline would be all of them, band saves nothing
+    if(r0 <= 0 || m_nearSine >= 1)
+    {
+        m_tolerance = 0;
+        return;
+    }
+
+    m_baseline = glm::normalize(m_baseline);
+
+    //any vector not parallel with baseline gives frame of planes around it
+    vec3 helper = glm::abs(m_baseline.z) < 0.9f ? vec3(0,0,1) : vec3(1,0,0);
+
+    m_planeX = glm::normalize(glm::cross(m_baseline, helper));
+    m_planeY = glm::cross(m_baseline, m_planeX);
+}
+
+float EpipolarGeometry::angle(const Line &line) const
+{
+    //component along baseline does not change the plane, rays from both cameras to one point give the same angle
+    return std::atan2(glm::dot(line.m_directionVector, m_planeY), glm::dot(line.m_directionVector, m_planeX));
+}
+
+bool EpipolarGeometry::nearBaseline(const Line &line) const
+{
+    //sine of angle between line and baseline, both directions of baseline
+    float length = glm::length(line.m_directionVector);
+
+    return length == 0 || glm::length(glm::cross(line.m_directionVector, m_baseline)) <= m_nearSine * length;
+}
+
+void EpipolarGeometry::sortByAngle(const QVector<Line> &lines, std::vector<std::pair<float, int>> &sorted) const
+{
+    sorted.clear();
+
+    for(int i = 0; i < lines.size(); i++)
+    {
+        sorted.push_back({nearBaseline(lines[i]) ? nearBaselineAngle : angle(lines[i]), i});
+    }
+
+    std::sort(sorted.begin(), sorted.end());
+}
+
+int EpipolarGeometry::nearBegin(const std::vector<std::pair<float, int>> &sorted)
+{
+    return int(std::lower_bound(sorted.begin(), sorted.end(), std::make_pair(nearBaselineAngle, -1)) - sorted.begin());
+}
@@ -0,0 +1,164 @@
+/*
+ *
+ * Copyright (C) 2014  Miroslav Krajicek, Faculty of Informatics Masaryk University (https://github.com/kaajo).
+ * All Rights Reserved.
+ *
+ * This file is part of WebCamCap.
+ *
+ * WebCamCap is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU LGPL version 3 as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WebCamCap is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU LGPL version 3
+ * along with WebCamCap. If not, see <http://www.gnu.org/licenses/lgpl-3.0.txt>.
+ *
+ */
+
+#ifndef EPIPOLARGEOMETRY_H
+#define EPIPOLARGEOMETRY_H
+
+#include "line.h"
+
+#include <algorithm>
+#include <climits>
+#include <utility>
+
+#include <QVector>
+#include <opencv2/core/core.hpp>
+
+/**
+ * @brief epipolar planes of two cameras, rays can meet only if they lie in (nearly) the same plane
+ *
+ * Every epipolar plane contains baseline, so it is given by its angle around baseline.
+ * Angles are computed from ray directions in world space, no camera matrices are needed.
+ *
+ * Rays meeting within maxError at distance r from baseline differ in angle by up to asin(maxError / r),
+ * so the band of tolerance holds all pairs meeting farther than r0 = maxError / sin(tolerance).
+ * A pair meeting closer than r0 has at least one ray within asin(2 (r0 + maxError) / (baseline - maxError))
+ * of baseline direction. Such rays are kept out of bands and tested with all rays of the other camera,
+ * so gating drops no pair the all-pairs search finds.
+ */
+class EpipolarGeometry
+{
+    glm::vec3 m_baseline, m_planeX, m_planeY;
+    float m_tolerance = 0;  /// radians, 0 gates nothing
+    float m_nearSine = 0;   /// rays closer to baseline direction are tested with all pairs
+
+public:
+    /// key of rays near baseline in sorted, above every angle of band
+    static constexpr float nearBaselineAngle = 4 * CV_PI;
+
+    /// tolerance in degrees, 0 disables gating, maxError of pairs gives rays near baseline
+    void set(glm::vec3 position1, glm::vec3 position2, float tolerance, float maxError);
+    bool valid() const {return m_tolerance > 0;}
+
+    /// angle of epipolar plane containing line, <-pi, pi>
+    float angle(const Line &line) const;
+
+    /// line may meet a line of other camera close to baseline, where planes of the pair differ more than tolerance
+    bool nearBaseline(const Line &line) const;
+
+    /// epipolar angle and index of every line sorted by angle, lines near baseline are at the end
+    void sortByAngle(const QVector<Line> &lines, std::vector<std::pair<float, int>> &sorted) const;
+
+    /// first position of lines near baseline in sorted
+    static int nearBegin(const std::vector<std::pair<float, int>> &sorted);
+
+    /// calls f(index) for every line of sorted with angle within tolerance of given angle
+    template<typename F>
+    void forBand(const std::vector<std::pair<float, int>> &sorted, float angle, F f) const;
+
+    /// calls f(begin, end) for positions in sorted with angle within tolerance, twice if band wraps around +-pi
+    template<typename F>
+    void forBandRange(const std::vector<std::pair<float, int>> &sorted, float angle, F f) const;
+
+    /// calls f(index) exactly once for every line of sorted that may meet line, band and lines near baseline
+    template<typename F>
+    void forCandidates(const std::vector<std::pair<float, int>> &sorted, const Line &line, F f) const;
+
+    /// calls f(begin, end) for ranges of sorted that may meet line, together they cover every candidate once
+    template<typename F>
+    void forCandidateRanges(const std::vector<std::pair<float, int>> &sorted, const Line &line, F f) const;
+};
+
+template<typename F>
+void EpipolarGeometry::forBand(const std::vector<std::pair<float, int>> &sorted, float angle, F f) const
+{
+    forBandRange(sorted, angle, [&](int begin, int end)
+    {
+        for(int k = begin; k < end; k++)
+        {
+            f(sorted[k].second);
+        }
+    });
+}
+
+template<typename F>
+void EpipolarGeometry::forBandRange(const std::vector<std::pair<float, int>> &sorted, float angle, F f) const
+{
+    auto band = [&](float low, float high)
+    {
+        auto begin = std::lower_bound(sorted.begin(), sorted.end(), std::make_pair(low, -1));
+        auto end = std::upper_bound(begin, sorted.end(), std::make_pair(high, INT_MAX));
+
+        if(begin != end)
+        {
+            f(int(begin - sorted.begin()), int(end - sorted.begin()));
+        }
+    };
+
+    band(angle - m_tolerance, angle + m_tolerance);
+
+    //band wraps around +-pi
+    if(angle - m_tolerance < -CV_PI)
+    {
+        band(angle - m_tolerance + 2*CV_PI, CV_PI);
+    }
+    else if(angle + m_tolerance > CV_PI)
+    {
+        band(-CV_PI, angle + m_tolerance - 2*CV_PI);
+    }
+}
+
+template<typename F>
+void EpipolarGeometry::forCandidates(const std::vector<std::pair<float, int>> &sorted, const Line &line, F f) const
+{
+    forCandidateRanges(sorted, line, [&](int begin, int end)
+    {
+        for(int k = begin; k < end; k++)
+        {
+            f(sorted[k].second);
+        }
+    });
+}
+
+template<typename F>
+void EpipolarGeometry::forCandidateRanges(const std::vector<std::pair<float, int>> &sorted, const Line &line, F f) const
+{
+    if(nearBaseline(line))
+    {
+        if(!sorted.empty())
+        {
+            f(0, int(sorted.size()));
+        }
+
+        return;
+    }
+
+    forBandRange(sorted, angle(line), f);
+
+    int near = nearBegin(sorted);
+
+    if(near < int(sorted.size()))
+    {
+        f(near, int(sorted.size()));
+    }
+}
+
+#endif // EPIPOLARGEOMETRY_H
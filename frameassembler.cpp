@@ -0,0 +1,174 @@
+/*
+ *
+ * Copyright (C) 2014  Miroslav Krajicek, Faculty of Informatics Masaryk University (https://github.com/kaajo).
+ * All Rights Reserved.
+ *
+ * This file is part of WebCamCap.
+ *
+ * WebCamCap is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU LGPL version 3 as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WebCamCap is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU LGPL version 3
+ * along with WebCamCap. If not, see <http://www.gnu.org/licenses/lgpl-3.0.txt>.
+ *
+ */
+
+#include "frameassembler.h"
+
+FrameAssembler::FrameAssembler(qint64 window, qint64 maxLatency)
+{
+    m_window = window;
+    m_maxLatency = maxLatency;
+}
+
+void FrameAssembler::setCameraCount(size_t count)
+{
+    m_pending.resize(count, PendingObservations(maxPending));
+    m_active.resize(count, true);
+}
+
+void FrameAssembler::removeCamera(size_t camera)
+{
+    if(camera >= m_pending.size())
+    {
+        return;
+    }
+
+    m_pending.erase(m_pending.begin() + camera);
+    m_active.erase(m_active.begin() + camera);
+}
+
+void FrameAssembler::setActive(size_t camera, bool active)
+{
+    if(camera >= m_active.size())
+    {
+        setCameraCount(camera + 1);
+    }
+
+    m_active[camera] = active;
+
+    if(!active)
+    {
+        m_pending[camera].clear();
+    }
+}
+
+void FrameAssembler::clear()
+{
+    for(size_t i = 0; i < m_pending.size(); i++)
+    {
+        m_pending[i].clear();
+    }
+
+    m_newest = 0;
+    m_assembled = m_skipped = 0;
+}
+
+void FrameAssembler::addObservation(size_t camera, const ObservationRecord &record)
+{
+    if(camera >= m_pending.size() || !m_active[camera])
+    {
+        return;
+    }
+
+    PendingObservations &queue = m_pending[camera];
+
+    //camera is running far ahead of the others
+    if(queue.full())
+    {
+        queue.pop();
+        ++m_skipped;
+    }
+
+    ObservationRecord &slot = queue.push();
+
+    if(slot.m_lines.size() < (size_t) record.m_count)
+    {
+        slot.m_lines.resize(record.m_count);
+    }
+
+    slot.m_timestamp = record.m_timestamp;
+    slot.m_count = record.m_count;
+    std::copy(record.m_lines.begin(), record.m_lines.begin() + record.m_count, slot.m_lines.begin());
+
+    if(record.m_timestamp > m_newest)
+    {
+        m_newest = record.m_timestamp;
+    }
+}
+
+bool FrameAssembler::assemble(MultiViewFrame &frame)
+{
+    bool anyPending = false;
+    qint64 reference = 0;
+
+    for(size_t i = 0; i < m_pending.size(); i++)
+    {
+        if(m_active[i] && !m_pending[i].empty() && (!anyPending || m_pending[i].front().m_timestamp < reference))
+        {
+            reference = m_pending[i].front().m_timestamp;
+            anyPending = true;
+        }
+    }
+
+    if(!anyPending)
+    {
+        return false;
+    }
+
+    bool complete = true;
+
+    for(size_t i = 0; i < m_pending.size(); i++)
+    {
+        if(m_active[i] && (m_pending[i].empty() || m_pending[i].front().m_timestamp > reference + m_window))
+        {
+            complete = false;
+            break;
+        }
+    }
+
+    //wait for late cameras until newer observations show they are not coming
+    if(!complete && m_newest < reference + m_window + m_maxLatency)
+    {
+        return false;
+    }
+
+    frame.m_timestamp = reference;
+    frame.m_present.assign(m_pending.size(), false);
+    frame.m_lines.resize(m_pending.size());
+
+    for(size_t i = 0; i < m_pending.size(); i++)
+    {
+        frame.m_lines[i].resize(0);
+
+        if(!m_active[i])
+        {
+            continue;
+        }
+
+        if(!m_pending[i].empty() && m_pending[i].front().m_timestamp <= reference + m_window)
+        {
+            const ObservationRecord &observation = m_pending[i].front();
+
+            frame.m_lines[i].resize(observation.m_count);
+            std::copy(observation.m_lines.begin(), observation.m_lines.begin() + observation.m_count, frame.m_lines[i].begin());
+            frame.m_present[i] = true;
+            m_pending[i].pop();
+        }
+        else
+        {
+            ++m_skipped;
+        }
+    }
+
+    ++m_assembled;
+
+    return true;
+}
@@ -0,0 +1,128 @@
+/*
+ *
+ * Copyright (C) 2014  Miroslav Krajicek, Faculty of Informatics Masaryk University (https://github.com/kaajo).
+ * All Rights Reserved.
+ *
+ * This file is part of WebCamCap.
+ *
+ * WebCamCap is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU LGPL version 3 as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WebCamCap is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU LGPL version 3
+ * along with WebCamCap. If not, see <http://www.gnu.org/licenses/lgpl-3.0.txt>.
+ *
+ */
+
+#ifndef FRAMEASSEMBLER_H
+#define FRAMEASSEMBLER_H
+
+#include "line.h"
+#include "spscqueue.h"
+
+#include <algorithm>
+#include <vector>
+
+#include <QVector>
+#include <QtGlobal>
+
+/// copies elements, destination keeps its own storage instead of sharing the source
+inline void copyLines(const QVector<Line> &from, QVector<Line> &to)
+{
+    to.resize(from.size());
+    std::copy(from.begin(), from.end(), to.begin());
+}
+
+/// observation handed from camera worker to fusion thread in place, nothing is allocated per frame
+class ObservationRecord
+{
+public:
+    qint64 m_timestamp = 0;
+    int m_count = 0;
+    int m_truncated = 0;        /// lines over size of slot, lost
+    std::vector<Line> m_lines;  /// sized once from maxBlobs of camera, first m_count are valid
+};
+
+typedef SpscQueue<ObservationRecord> ObservationQueue;
+
+/// fixed ring of observations waiting for other cameras, slots keep their storage
+class PendingObservations
+{
+    std::vector<ObservationRecord> m_slots;
+    size_t m_first = 0;
+    size_t m_count = 0;
+
+public:
+    PendingObservations(size_t slots = 8) : m_slots(slots) {}
+
+    bool empty() const {return m_count == 0;}
+    bool full() const {return m_count == m_slots.size();}
+    const ObservationRecord &front() const {return m_slots[m_first];}
+
+    /// slot after the last one, its lines grow to the largest observation and stay
+    ObservationRecord &push()
+    {
+        return m_slots[(m_first + m_count++) % m_slots.size()];
+    }
+
+    void pop()
+    {
+        m_first = (m_first + 1) % m_slots.size();
+        --m_count;
+    }
+
+    void clear() {m_first = m_count = 0;}
+};
+
+/// observations of all cameras belonging to one moment
+class MultiViewFrame
+{
+public:
+    qint64 m_timestamp = 0;
+    std::vector<bool> m_present;
+    QVector<QVector<Line>> m_lines;     /// lines are copied into existing storage, keep it unshared
+};
+
+/// groups per-camera observations by capture time, late or missing cameras are skipped
+class FrameAssembler
+{
+    std::vector<PendingObservations> m_pending;
+    std::vector<bool> m_active;
+
+    qint64 m_window;     /// microseconds, observations closer than this belong to one frame
+    qint64 m_maxLatency; /// microseconds to wait for missing cameras
+    qint64 m_newest = 0;
+
+    static const size_t maxPending = 8;
+    size_t m_assembled = 0;
+    size_t m_skipped = 0;
+
+public:
+    FrameAssembler(qint64 window = 16000, qint64 maxLatency = 50000);
+
+    void setCameraCount(size_t count);
+    /// later cameras move one index down, as in Room
+    void removeCamera(size_t camera);
+    void setActive(size_t camera, bool active);
+    void clear();
+
+    void setWindow(qint64 window) {m_window = window;}
+    void setMaxLatency(qint64 latency) {m_maxLatency = latency;}
+    qint64 window() const {return m_window;}
+    qint64 maxLatency() const {return m_maxLatency;}
+
+    size_t assembled() const {return m_assembled;}
+    size_t skipped() const {return m_skipped;}
+
+    /// copies valid lines of record, record may be popped from its queue right after
+    void addObservation(size_t camera, const ObservationRecord &record);
+    bool assemble(MultiViewFrame &frame);
+};
+
+#endif // FRAMEASSEMBLER_H
@@ -0,0 +1,377 @@
+/*
+ *
+ * Copyright (C) 2014  Miroslav Krajicek, Faculty of Informatics Masaryk University (https://github.com/kaajo).
+ * All Rights Reserved.
+ *
+ * This file is part of WebCamCap.
+ *
+ * WebCamCap is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU LGPL version 3 as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WebCamCap is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU LGPL version 3
+ * along with WebCamCap. If not, see <http://www.gnu.org/licenses/lgpl-3.0.txt>.
+ *
+ */
+
+#include "framesource.h"
+
+#include <thread>
+#include <vector>
+#include <cstdio>
+#include <cstring>
+#include <cctype>
+#include <iostream>
+
+using namespace cv;
+
+const QString sourceTypeKey("source");
+const QString sourcePathKey("sourcePath");
+const QString replayModeKey("replayMode");
+const QString replayFpsKey("replayFps");
+const QString replayLoopKey("replayLoop");
+const QString firstIndexKey("firstIndex");
+
+const QString deviceSourceName("device");
+const QString videoSourceName("video");
+const QString imagesSourceName("images");
+
+const QString realTimeModeName("realtime");
+const QString fastModeName("fast");
+
+FrameSource *FrameSource::fromVariantMap(QVariantMap &varMap, int usbId)
+{
+    QString type = varMap.value(sourceTypeKey, deviceSourceName).toString();
+
+    ReplayMode mode = varMap.value(replayModeKey, realTimeModeName).toString() == fastModeName ? ReplayMode::ASFASTASPOSSIBLE : ReplayMode::REALTIME;
+    double fps = varMap.value(replayFpsKey, 0).toDouble();
+    bool loop = varMap.value(replayLoopKey, true).toBool();
+    QString path = varMap[sourcePathKey].toString();
+
+    if(type == videoSourceName)
+    {
+        return new VideoFileFrameSource(path, mode, fps, loop);
+    }
+    else if(type == imagesSourceName)
+    {
+        return new ImageSequenceFrameSource(path, mode, fps > 0 ? fps : 30, loop, varMap.value(firstIndexKey, 0).toInt());
+    }
+
+    if(type != deviceSourceName)
+    {
+        std::cout << "unknown frame source " << type.toStdString() << ", using device " << usbId << std::endl;
+    }
+
+    return new DeviceFrameSource(usbId);
+}
+
+DeviceFrameSource::DeviceFrameSource(int usbId)
+{
+    m_usbId = usbId;
+}
+
+bool DeviceFrameSource::open()
+{
+    return m_capture.open(m_usbId);
+}
+
+void DeviceFrameSource::release()
+{
+    m_capture.release();
+}
+
+bool DeviceFrameSource::read(Mat &frame)
+{
+    //stamp before decoding, grab returns as soon as the driver hands over the frame
+    if(!m_capture.grab())
+    {
+        return false;
+    }
+
+    m_timestamp = steadyMicroseconds();
+
+    return m_capture.retrieve(frame);
+}
+
+void DeviceFrameSource::setResolution(int width, int height)
+{
+    m_capture.set(CV_CAP_PROP_FRAME_WIDTH, width);
+    m_capture.set(CV_CAP_PROP_FRAME_HEIGHT, height);
+}
+
+QVariantMap DeviceFrameSource::toVariantMap() const
+{
+    QVariantMap retVal;
+
+    retVal[sourceTypeKey] = deviceSourceName;
+
+    return retVal;
+}
+
+ReplayFrameSource::ReplayFrameSource(QString path, ReplayMode mode, double fps, bool loop)
+{
+    m_path = path;
+    m_mode = mode;
+    m_fps = fps;
+    m_loop = loop;
+}
+
+void ReplayFrameSource::pace()
+{
+    if(m_mode == ReplayMode::ASFASTASPOSSIBLE || m_fps <= 0)
+    {
+        return;
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    auto period = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(1.0 / m_fps));
+
+    if(!m_started)
+    {
+        m_started = true;
+        m_nextFrameTime = now;
+        return;
+    }
+
+    m_nextFrameTime += period;
+
+    //processing fell behind more than one frame, do not try to catch up
+    if(m_nextFrameTime + period < now)
+    {
+        m_nextFrameTime = now;
+        return;
+    }
+
+    std::this_thread::sleep_until(m_nextFrameTime);
+}
+
+void ReplayFrameSource::stampFrame()
+{
+    //frames looped from the beginning keep counting, timestamps never go back
+    m_timestamp = replayStart() + qRound64(m_stampedFrames * 1e6 / m_fps);
+    ++m_stampedFrames;
+}
+
+qint64 ReplayFrameSource::replayStart()
+{
+    static const qint64 start = steadyMicroseconds();
+
+    return start;
+}
+
+QVariantMap ReplayFrameSource::toVariantMap() const
+{
+    QVariantMap retVal;
+
+    retVal[sourcePathKey] = m_path;
+    retVal[replayModeKey] = m_mode == ReplayMode::ASFASTASPOSSIBLE ? fastModeName : realTimeModeName;
+    retVal[replayFpsKey] = m_fps;
+    retVal[replayLoopKey] = m_loop;
+
+    return retVal;
+}
+
+VideoFileFrameSource::VideoFileFrameSource(QString path, ReplayMode mode, double fps, bool loop) :
+    ReplayFrameSource(path, mode, fps, loop)
+{
+}
+
+bool VideoFileFrameSource::open()
+{
+    if(!m_capture.open(m_path.toStdString()))
+    {
+        return false;
+    }
+
+    if(m_fps <= 0)
+    {
+        m_fps = m_capture.get(CV_CAP_PROP_FPS);
+    }
+
+    if(m_fps <= 0)
+    {
+        m_fps = 30;
+    }
+
+    restartPacing();
+
+    return true;
+}
+
+void VideoFileFrameSource::release()
+{
+    m_capture.release();
+}
+
+bool VideoFileFrameSource::read(Mat &frame)
+{
+    if(!m_capture.read(frame))
+    {
+        if(!m_loop)
+        {
+            return false;
+        }
+
+        m_capture.set(CV_CAP_PROP_POS_FRAMES, 0);
+
+        if(!m_capture.read(frame))
+        {
+            return false;
+        }
+    }
+
+    pace();
+    stampFrame();
+
+    return true;
+}
+
+QVariantMap VideoFileFrameSource::toVariantMap() const
+{
+    QVariantMap retVal = ReplayFrameSource::toVariantMap();
+
+    retVal[sourceTypeKey] = videoSourceName;
+
+    return retVal;
+}
+
+ImageSequenceFrameSource::ImageSequenceFrameSource(QString pattern, ReplayMode mode, double fps, bool loop, int firstIndex) :
+    ReplayFrameSource(pattern, mode, fps, loop)
+{
+    m_firstIndex = m_index = firstIndex;
+}
+
+bool ImageSequenceFrameSource::isIndexPattern(const std::string &pattern)
+{
+    //pattern is the format string of snprintf, anything but one int conversion would read missing arguments
+    int conversions = 0;
+
+    for(size_t i = 0; i < pattern.size(); i++)
+    {
+        if(pattern[i] != '%')
+        {
+            continue;
+        }
+
+        if(++i < pattern.size() && pattern[i] == '%')
+        {
+            continue;
+        }
+
+        while(i < pattern.size() && pattern[i] != '\0' && strchr("-+ #0", pattern[i]))
+        {
+            ++i;
+        }
+
+        while(i < pattern.size() && isdigit((unsigned char) pattern[i]))
+        {
+            ++i;
+        }
+
+        if(i < pattern.size() && pattern[i] == '.')
+        {
+            ++i;
+
+            while(i < pattern.size() && isdigit((unsigned char) pattern[i]))
+            {
+                ++i;
+            }
+        }
+
+        if(i >= pattern.size() || pattern[i] == '\0' || !strchr("dioxX", pattern[i]))
+        {
+            return false;
+        }
+
+        ++conversions;
+    }
+
+    return conversions == 1;
+}
+
+std::string ImageSequenceFrameSource::fileName(int index) const
+{
+    std::string pattern = m_path.toStdString();
+    std::vector<char> buffer(pattern.size() + 32);
+
+    snprintf(buffer.data(), buffer.size(), pattern.c_str(), index);
+
+    return std::string(buffer.data());
+}
+
+bool ImageSequenceFrameSource::open()
+{
+    m_index = m_firstIndex;
+
+    if(m_fps <= 0)
+    {
+        m_fps = 30;
+    }
+
+    if(!isIndexPattern(m_path.toStdString()))
+    {
+        std::cout << "image sequence " << m_path.toStdString() << " has to contain exactly one integer conversion like %05d" << std::endl;
+        m_opened = false;
+        return false;
+    }
+
+    m_opened = !imread(fileName(m_index)).empty();
+
+    restartPacing();
+
+    return m_opened;
+}
+
+void ImageSequenceFrameSource::release()
+{
+    m_opened = false;
+}
+
+bool ImageSequenceFrameSource::read(Mat &frame)
+{
+    if(!m_opened)
+    {
+        return false;
+    }
+
+    frame = imread(fileName(m_index));
+
+    if(frame.empty())
+    {
+        if(!m_loop || m_index == m_firstIndex)
+        {
+            return false;
+        }
+
+        m_index = m_firstIndex;
+        frame = imread(fileName(m_index));
+
+        if(frame.empty())
+        {
+            return false;
+        }
+    }
+
+    ++m_index;
+
+    pace();
+    stampFrame();
+
+    return true;
+}
+
+QVariantMap ImageSequenceFrameSource::toVariantMap() const
+{
+    QVariantMap retVal = ReplayFrameSource::toVariantMap();
+
+    retVal[sourceTypeKey] = imagesSourceName;
+    retVal[firstIndexKey] = m_firstIndex;
+
+    return retVal;
+}
@@ -0,0 +1,156 @@
+/*
+ *
+ * Copyright (C) 2014  Miroslav Krajicek, Faculty of Informatics Masaryk University (https://github.com/kaajo).
+ * All Rights Reserved.
+ *
+ * This file is part of WebCamCap.
+ *
+ * WebCamCap is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU LGPL version 3 as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WebCamCap is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU LGPL version 3
+ * along with WebCamCap. If not, see <http://www.gnu.org/licenses/lgpl-3.0.txt>.
+ *
+ */
+
+#ifndef FRAMESOURCE_H
+#define FRAMESOURCE_H
+
+#include <QString>
+#include <QVariantMap>
+#include <QtGlobal>
+
+#include <chrono>
+
+#include <opencv2/highgui/highgui.hpp>
+
+enum class ReplayMode
+{
+    REALTIME,       /// frames are delivered at recorded frame rate
+    ASFASTASPOSSIBLE /// frames are delivered as soon as they are decoded
+};
+
+/// steady clock time in microseconds, used to stamp frames grabbed from devices
+inline qint64 steadyMicroseconds()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/// Source of frames for one CaptureCamera (live device or recorded replay)
+class FrameSource
+{
+protected:
+    qint64 m_timestamp = 0;
+
+public:
+    virtual ~FrameSource() {}
+
+    virtual bool open() = 0;
+    virtual void release() = 0;
+    virtual bool isOpened() const = 0;
+    virtual bool read(cv::Mat &frame) = 0;
+    virtual void setResolution(int /*width*/, int /*height*/) {}
+
+    /// capture time of last read frame
+    qint64 timestamp() const {return m_timestamp;}
+
+    virtual QVariantMap toVariantMap() const = 0;
+
+    /// creates source described by camera's variant map, live device when no source is stored
+    static FrameSource *fromVariantMap(QVariantMap &varMap, int usbId);
+};
+
+class DeviceFrameSource : public FrameSource
+{
+    int m_usbId;
+    cv::VideoCapture m_capture;
+
+public:
+    explicit DeviceFrameSource(int usbId);
+
+    bool open();
+    void release();
+    bool isOpened() const {return m_capture.isOpened();}
+    bool read(cv::Mat &frame);
+    void setResolution(int width, int height);
+
+    QVariantMap toVariantMap() const;
+};
+
+/// common pacing for recorded sources
+class ReplayFrameSource : public FrameSource
+{
+    std::chrono::steady_clock::time_point m_nextFrameTime;
+    bool m_started = false;
+    qint64 m_stampedFrames = 0;
+
+protected:
+    QString m_path;
+    ReplayMode m_mode;
+    double m_fps;
+    bool m_loop;
+
+    void pace();
+    void restartPacing() {m_started = false; m_stampedFrames = 0;}
+    /// stamps read frame by its position in recording, independent of pacing and decoding time
+    void stampFrame();
+
+public:
+    ReplayFrameSource(QString path, ReplayMode mode, double fps, bool loop);
+
+    /// origin of replay timestamps, shared by all replay sources so the same frame index of every camera gets the same time
+    static qint64 replayStart();
+
+    QString path() const {return m_path;}
+    ReplayMode mode() const {return m_mode;}
+    void setMode(ReplayMode mode) {m_mode = mode;}
+
+    QVariantMap toVariantMap() const;
+};
+
+class VideoFileFrameSource : public ReplayFrameSource
+{
+    cv::VideoCapture m_capture;
+
+public:
+    VideoFileFrameSource(QString path, ReplayMode mode = ReplayMode::REALTIME, double fps = 0, bool loop = true);
+
+    bool open();
+    void release();
+    bool isOpened() const {return m_capture.isOpened();}
+    bool read(cv::Mat &frame);
+
+    QVariantMap toVariantMap() const;
+};
+
+/// numbered images, path is printf-like pattern e.g. "recording/cam1_%05d.png"
+class ImageSequenceFrameSource : public ReplayFrameSource
+{
+    int m_firstIndex;
+    int m_index;
+    bool m_opened = false;
+
+    std::string fileName(int index) const;
+
+public:
+    /// true when pattern has exactly one integer conversion, "%%" is allowed
+    static bool isIndexPattern(const std::string &pattern);
+
+    ImageSequenceFrameSource(QString pattern, ReplayMode mode = ReplayMode::REALTIME, double fps = 30, bool loop = true, int firstIndex = 0);
+
+    bool open();
+    void release();
+    bool isOpened() const {return m_opened;}
+    bool read(cv::Mat &frame);
+
+    QVariantMap toVariantMap() const;
+};
+
+#endif // FRAMESOURCE_H
@@ -0,0 +1,47 @@
+/*
+ *
+ * Copyright (C) 2014  Miroslav Krajicek, Faculty of Informatics Masaryk University (https://github.com/kaajo).
+ * All Rights Reserved.
+ *
+ * This file is part of WebCamCap.
+ *
+ * WebCamCap is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU LGPL version 3 as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WebCamCap is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU LGPL version 3
+ * along with WebCamCap. If not, see <http://www.gnu.org/licenses/lgpl-3.0.txt>.
+ *
+ */
+
+#ifndef FUSIONTHREAD_H
+#define FUSIONTHREAD_H
+
+#include <atomic>
+#include <functional>
+
+#include <QThread>
+
+/// calls step until stopped, step returns false if there was nothing to do and the thread naps
+class FusionThread : public QThread
+{
+    std::function<bool()> m_step;
+    std::atomic<bool> m_running;
+
+public:
+    explicit FusionThread(std::function<bool()> step);
+
+    void start();
+    void stop();
+
+protected:
+    void run();
+};
+
+#endif // FUSIONTHREAD_H
@@ -0,0 +1,155 @@
+/*
+ *
+ * Copyright (C) 2014  Miroslav Krajicek, Faculty of Informatics Masaryk University (https://github.com/kaajo).
+ * All Rights Reserved.
+ *
+ * This file is part of WebCamCap.
+ *
+ * WebCamCap is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU LGPL version 3 as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WebCamCap is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU LGPL version 3
+ * along with WebCamCap. If not, see <http://www.gnu.org/licenses/lgpl-3.0.txt>.
+ *
+ */
+
+#include "grabthread.h"
+
+FrameRingBuffer::FrameRingBuffer(size_t capacity) :
+    m_slots(capacity < 2 ? 2 : capacity),
+    m_grabbed(0), m_processed(0), m_dropped(0)
+{
+}
+
+void FrameRingBuffer::allocate(int rows, int cols, int type)
+{
+    QMutexLocker l(&m_mutex);
+
+    for(size_t i = 0; i < m_slots.size(); i++)
+    {
+        m_slots[i].m_image.create(rows, cols, type);
+        m_slots[i].m_ready = false;
+    }
+
+    m_writeIndex = 0;
+    m_latestIndex = -1;
+}
+
+void FrameRingBuffer::clear()
+{
+    QMutexLocker l(&m_mutex);
+
+    for(size_t i = 0; i < m_slots.size(); i++)
+    {
+        m_slots[i].m_ready = false;
+    }
+
+    m_latestIndex = -1;
+    m_grabbed = m_processed = m_dropped = 0;
+}
+
+cv::Mat &FrameRingBuffer::beginWrite()
+{
+    QMutexLocker l(&m_mutex);
+
+    Slot &slot = m_slots[m_writeIndex];
+
+    if(slot.m_ready)
+    {
+        ++m_dropped;
+        slot.m_ready = false;
+
+        if(m_latestIndex == (int) m_writeIndex)
+        {
+            m_latestIndex = -1;
+        }
+    }
+
+    return slot.m_image;
+}
+
+void FrameRingBuffer::commitWrite(qint64 timestamp)
+{
+    QMutexLocker l(&m_mutex);
+
+    m_slots[m_writeIndex].m_timestamp = timestamp;
+    m_slots[m_writeIndex].m_ready = true;
+    m_latestIndex = m_writeIndex;
+    m_writeIndex = (m_writeIndex + 1) % m_slots.size();
+
+    ++m_grabbed;
+
+    m_frameReady.wakeAll();
+}
+
+bool FrameRingBuffer::takeLatest(cv::Mat &frame, qint64 &timestamp, unsigned long timeout)
+{
+    QMutexLocker l(&m_mutex);
+
+    if(m_latestIndex == -1)
+    {
+        m_frameReady.wait(&m_mutex, timeout);
+
+        if(m_latestIndex == -1)
+        {
+            return false;
+        }
+    }
+
+    //buffers are exchanged, not copied
+    cv::swap(frame, m_slots[m_latestIndex].m_image);
+    timestamp = m_slots[m_latestIndex].m_timestamp;
+    m_slots[m_latestIndex].m_ready = false;
+
+    for(size_t i = 0; i < m_slots.size(); i++)
+    {
+        if(m_slots[i].m_ready)
+        {
+            ++m_dropped;
+            m_slots[i].m_ready = false;
+        }
+    }
+
+    m_latestIndex = -1;
+    ++m_processed;
+
+    return true;
+}
+
+GrabThread::GrabThread(FrameSource *source, FrameRingBuffer *buffer) :
+    m_running(true)
+{
+    m_source = source;
+    m_buffer = buffer;
+}
+
+void GrabThread::stop()
+{
+    m_running = false;
+    wait();
+}
+
+void GrabThread::run()
+{
+    while(m_running)
+    {
+        cv::Mat &image = m_buffer->beginWrite();
+
+        if(m_source->read(image) && !image.empty())
+        {
+            m_buffer->commitWrite(m_source->timestamp());
+        }
+        else
+        {
+            //device lost or replay finished
+            msleep(10);
+        }
+    }
+}
@@ -0,0 +1,90 @@
+/*
+ *
+ * Copyright (C) 2014  Miroslav Krajicek, Faculty of Informatics Masaryk University (https://github.com/kaajo).
+ * All Rights Reserved.
+ *
+ * This file is part of WebCamCap.
+ *
+ * WebCamCap is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU LGPL version 3 as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WebCamCap is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU LGPL version 3
+ * along with WebCamCap. If not, see <http://www.gnu.org/licenses/lgpl-3.0.txt>.
+ *
+ */
+
+#ifndef GRABTHREAD_H
+#define GRABTHREAD_H
+
+#include "framesource.h"
+
+#include <atomic>
+#include <vector>
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+
+/// preallocated ring of frames, grabber overwrites the oldest unread frame
+class FrameRingBuffer
+{
+    class Slot
+    {
+    public:
+        cv::Mat m_image;
+        qint64 m_timestamp = 0;
+        bool m_ready = false;
+    };
+
+    std::vector<Slot> m_slots;
+    size_t m_writeIndex = 0;
+    int m_latestIndex = -1;
+
+    QMutex m_mutex;
+    QWaitCondition m_frameReady;
+
+    std::atomic<size_t> m_grabbed;
+    std::atomic<size_t> m_processed;
+    std::atomic<size_t> m_dropped;
+
+public:
+    explicit FrameRingBuffer(size_t capacity = 3);
+
+    void allocate(int rows, int cols, int type);
+    void clear();
+
+    /// slot for next grabbed frame, only the grabbing thread may write to it until commitWrite
+    cv::Mat &beginWrite();
+    void commitWrite(qint64 timestamp);
+
+    /// swaps the freshest frame into frame, older unread frames are dropped
+    bool takeLatest(cv::Mat &frame, qint64 &timestamp, unsigned long timeout);
+
+    size_t grabbed() const {return m_grabbed;}
+    size_t processed() const {return m_processed;}
+    size_t dropped() const {return m_dropped;}
+};
+
+class GrabThread : public QThread
+{
+    FrameSource *m_source;
+    FrameRingBuffer *m_buffer;
+    std::atomic<bool> m_running;
+
+public:
+    GrabThread(FrameSource *source, FrameRingBuffer *buffer);
+
+    void stop();
+
+protected:
+    void run();
+};
+
+#endif // GRABTHREAD_H
@@ -23,6 +23,7 @@
 #include "line.h"
 #include <glm/gtx/norm.hpp>
 #include <glm/gtx/compatibility.hpp>
+#include <algorithm>
 #include <cmath>
 
 using glm::vec2;
@@ -110,22 +111,59 @@ float Line::LineAngle(vec2 v1, vec2 v2)
     //CCW is positive
 }
 
-vec3 Line::Intersection(Line &l1, Line &l2, float Epsilon)
+bool Line::Intersection(const Line &l1, const Line &l2, float Epsilon, vec3 &point, float &distance)
 {
-    vec3 point1, point2;
+    //parallel lines keep their positions as closest points
+    vec3 point1 = l1.m_position, point2 = l2.m_position;
 
     Line::ClosestPointsOnTwoLines(l1, l2, point1, point2);
-    if(Epsilon > Line::DistanceTwoPoints(point1, point2))
+    distance = Line::DistanceTwoPoints(point1, point2);
+
+    if(distance < Epsilon)
+    {
+        point = Line::AveragePoint(point1, point2);
+        return true;
+    }
+
+    return false;
+}
+
+bool Line::ClipToBox(Line &line, vec3 boxMin, vec3 boxMax)
+{
+    float tmin = 0, tmax = std::numeric_limits<float>::max();
+
+    for(int axis = 0; axis < 3; axis++)
     {
-        l2.m_numberOfIntersections += 1;
-        l2.found = true;
+        float origin = line.m_position[axis];
+        float direction = line.m_directionVector[axis];
+
+        //parallel to slab, inside or never
+        if(direction == 0)
+        {
+            if(origin < boxMin[axis] || origin > boxMax[axis])
+            {
+                return false;
+            }
+
+            continue;
+        }
+
+        float t1 = (boxMin[axis] - origin) / direction;
+        float t2 = (boxMax[axis] - origin) / direction;
 
-        return Line::AveragePoint(point1, point2);
+        tmin = std::max(tmin, std::min(t1, t2));
+        tmax = std::min(tmax, std::max(t1, t2));
     }
-    else
+
+    if(tmin > tmax)
     {
-        return vec3(0.0f,0.0f,0.0f);
+        return false;
     }
+
+    line.m_tmin = tmin;
+    line.m_tmax = tmax;
+
+    return true;
 }
 
 //operators
@@ -26,6 +26,7 @@
 #include <iostream>
 #include <vector>
 #include <string>
+#include <limits>
 #include <glm/glm.hpp>
 #include <glm/vec3.hpp>
 
@@ -39,11 +40,12 @@ typedef struct Pnt
 class Line
 {
 public:
-    bool found = false;
     glm::vec3 m_position;
     glm::vec3 m_directionVector;
 
-    size_t m_numberOfIntersections = 0;
+    //part of line inside room, position + t * direction for t in <m_tmin, m_tmax>
+    float m_tmin = -std::numeric_limits<float>::max();
+    float m_tmax = std::numeric_limits<float>::max();
 
     Line();
     Line(glm::vec3 pos, glm::vec3 vec);
@@ -55,7 +57,10 @@ public:
     static glm::vec3 AveragePoint(glm::vec3 point1, glm::vec3 point2);
     static float LineAngle(Line l1, Line l2);
     static float LineAngle(glm::vec2 v1, glm::vec2 v2);
-    static glm::vec3 Intersection(Line &l1, Line &l2, float Epsilon);
+    /// midpoint of closest points if lines are closer than Epsilon, distance of closest points tells quality of intersection
+    static bool Intersection(const Line &l1, const Line &l2, float Epsilon, glm::vec3 &point, float &distance);
+    /// slab test, sets m_tmin and m_tmax to the part of ray (t >= 0) inside box, false if ray misses it
+    static bool ClipToBox(Line &line, glm::vec3 boxMin, glm::vec3 boxMax);
 };
 
 std::ostream& operator << (std::ostream &stream,const glm::vec3 &position);
@@ -22,6 +22,7 @@
 
 #include <QtWidgets/QApplication>
 #include "Gui/mainwindow.h"
+#include "benchmark.h"
 #include <GL/glut.h>
 #include <signal.h>
 
@@ -58,6 +59,12 @@ int main(int argc, char *argv[])
     QApplication a(argc, argv);
     app = &a;
 
+    //cameras of loaded project need the application, main window does not
+    if(benchmarkRequested(a.arguments()))
+    {
+        return runBenchmark(a.arguments());
+    }
+
     MainWindow w;
     w.show();
 
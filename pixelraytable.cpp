@@ -0,0 +1,102 @@
+/*
+ *
+ * Copyright (C) 2014  Miroslav Krajicek, Faculty of Informatics Masaryk University (https://github.com/kaajo).
+ * All Rights Reserved.
+ *
+ * This file is part of WebCamCap.
+ *
+ * WebCamCap is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU LGPL version 3 as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WebCamCap is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU LGPL version 3
+ * along with WebCamCap. If not, see <http://www.gnu.org/licenses/lgpl-3.0.txt>.
+ *
+ */
+
+#include "pixelraytable.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include <QFile>
+#include <QtConcurrent/QtConcurrent>
+
+void PixelRayTable::build(int width, int height, double anglePerPixel, const cv::Mat &rotation, glm::vec3 centerDirection)
+{
+    //mapped memory is read only, create would reuse it for the same size
+    clear();
+    m_rays.create(height, width, CV_32FC3);
+
+    const double radians = anglePerPixel * CV_PI / 180.0;
+    const double length = glm::length(centerDirection);
+
+    glm::dvec3 side(rotation.at<float>(0,0), rotation.at<float>(0,1), rotation.at<float>(0,2));
+    glm::dvec3 up(rotation.at<float>(1,0), rotation.at<float>(1,1), rotation.at<float>(1,2));
+    glm::dvec3 back(rotation.at<float>(2,0), rotation.at<float>(2,1), rotation.at<float>(2,2));
+
+    //in camera coordinates ray is length * (cos(b) sin(a), -sin(b), -cos(b) cos(a)),
+    //column part sin(a) side - cos(a) back is shared by all rows
+    std::vector<glm::dvec3> columns(width);
+
+    for(int x = 0; x < width; x++)
+    {
+        double a = (x - width/2.0) * radians;
+        columns[x] = std::sin(a) * side - std::cos(a) * back;
+    }
+
+    std::vector<int> rows(height);
+
+    for(int y = 0; y < height; y++)
+    {
+        rows[y] = y;
+    }
+
+    QtConcurrent::blockingMap(rows, [&](int y)
+    {
+        double b = (y - height/2.0) * radians;
+        double scale = length * std::cos(b);
+        glm::dvec3 offset = -length * std::sin(b) * up;
+
+        float *ray = m_rays.ptr<float>(y);
+
+        for(int x = 0; x < width; x++, ray += 3)
+        {
+            ray[0] = scale * columns[x].x + offset.x;
+            ray[1] = scale * columns[x].y + offset.y;
+            ray[2] = scale * columns[x].z + offset.z;
+        }
+    });
+}
+
+void PixelRayTable::map(std::shared_ptr<QFile> file, const uchar *data, int width, int height)
+{
+    m_rays = cv::Mat(height, width, CV_32FC3, const_cast<uchar*>(data));
+    m_mapping = file;
+}
+
+glm::vec3 PixelRayTable::interpolate(glm::vec2 pixel) const
+{
+    float x = std::min(std::max(pixel.x, 0.0f), (float) (m_rays.cols - 1));
+    float y = std::min(std::max(pixel.y, 0.0f), (float) (m_rays.rows - 1));
+
+    int x0 = x;
+    int y0 = y;
+    int x1 = std::min(x0 + 1, m_rays.cols - 1);
+    int y1 = std::min(y0 + 1, m_rays.rows - 1);
+
+    float fx = x - x0;
+    float fy = y - y0;
+
+    glm::vec3 top = at(x0, y0) * (1 - fx) + at(x1, y0) * fx;
+    glm::vec3 bottom = at(x0, y1) * (1 - fx) + at(x1, y1) * fx;
+
+    return top * (1 - fy) + bottom * fy;
+}
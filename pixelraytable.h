@@ -0,0 +1,71 @@
+/*
+ *
+ * Copyright (C) 2014  Miroslav Krajicek, Faculty of Informatics Masaryk University (https://github.com/kaajo).
+ * All Rights Reserved.
+ *
+ * This file is part of WebCamCap.
+ *
+ * WebCamCap is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU LGPL version 3 as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WebCamCap is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU LGPL version 3
+ * along with WebCamCap. If not, see <http://www.gnu.org/licenses/lgpl-3.0.txt>.
+ *
+ */
+
+#ifndef PIXELRAYTABLE_H
+#define PIXELRAYTABLE_H
+
+#include <memory>
+
+#include <glm/glm.hpp>
+#include <opencv2/core/core.hpp>
+
+class QFile;
+
+/**
+ * @brief world direction of ray through every pixel, stored row by row in one CV_32FC3 block
+ *
+ * Model is the angle-per-pixel model of CaptureCamera: pixel is rotated by (x - width/2) * angle around camera up
+ * and by (y - height/2) * angle around camera side, rays keep length of vector to room center.
+ */
+class PixelRayTable
+{
+    cv::Mat m_rays;
+    std::shared_ptr<QFile> m_mapping;   /// owner of mapped memory, rays point into it
+
+public:
+    /**
+     * @param rotation 4x4 CV_32F, rows are camera side, up and backward vector in world coordinates
+     * @param centerDirection vector from camera to room center, gives length of rays
+     */
+    void build(int width, int height, double anglePerPixel, const cv::Mat &rotation, glm::vec3 centerDirection);
+
+    /// uses rays stored in memory mapped file instead of building them, file stays mapped while table exists
+    void map(std::shared_ptr<QFile> file, const uchar *data, int width, int height);
+
+    void clear() {m_rays.release(); m_mapping.reset();}
+    bool empty() const {return m_rays.empty();}
+    size_t bytes() const {return m_rays.total() * m_rays.elemSize();}
+
+    int width() const {return m_rays.cols;}
+    int height() const {return m_rays.rows;}
+    bool mapped() const {return m_mapping != nullptr;}
+
+    /// continuous CV_32FC3 data
+    const cv::Mat &rays() const {return m_rays;}
+
+    glm::vec3 at(int x, int y) const {const float *ray = m_rays.ptr<float>(y) + 3*x; return glm::vec3(ray[0], ray[1], ray[2]);}
+
+    /// bilinear interpolation between rays of neighbouring pixels, pixel is clamped to image
+    glm::vec3 interpolate(glm::vec2 pixel) const;
+};
+
+#endif // PIXELRAYTABLE_H
@@ -0,0 +1,150 @@
+/*
+ *
+ * Copyright (C) 2014  Miroslav Krajicek, Faculty of Informatics Masaryk University (https://github.com/kaajo).
+ * All Rights Reserved.
+ *
+ * This file is part of WebCamCap.
+ *
+ * WebCamCap is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU LGPL version 3 as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WebCamCap is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU LGPL version 3
+ * along with WebCamCap. If not, see <http://www.gnu.org/licenses/lgpl-3.0.txt>.
+ *
+ */
+
+#include "pointwelder.h"
+
+#include <algorithm>
+#include <cmath>
+
+using glm::ivec3;
+using glm::vec3;
+
+int PointWelder::find(int point)
+{
+    while(m_parent[point] != point)
+    {
+        m_parent[point] = m_parent[m_parent[point]];
+        point = m_parent[point];
+    }
+
+    return point;
+}
+
+int PointWelder::slot(ivec3 cell) const
+{
+    const size_t mask = m_table.size() - 1;
+    size_t index = ((unsigned) cell.x * 73856093u ^ (unsigned) cell.y * 19349663u ^ (unsigned) cell.z * 83492791u) & mask;
+
+    //linear probing, table is at most half full
+    while(m_table[index].m_head != -1 && m_table[index].m_cell != cell)
+    {
+        index = (index + 1) & mask;
+    }
+
+    return index;
+}
+
+size_t PointWelder::capacity() const
+{
+    return m_table.capacity() * sizeof(Slot) + m_pointCells.capacity() * sizeof(ivec3) + (m_next.capacity() + m_parent.capacity()) * sizeof(int)
+            + m_sums.capacity() * sizeof(vec3) + m_weightSums.capacity() * sizeof(float);
+}
+
+void PointWelder::weld(std::vector<vec3> &points, const std::vector<float> &weights, float radius)
+{
+    const int count = points.size();
+
+    if(count < 2 || radius <= 0)
+    {
+        return;
+    }
+
+    size_t tableSize = 16;
+
+    while(tableSize < 2 * points.size())
+    {
+        tableSize *= 2;
+    }
+
+    m_table.assign(tableSize, {ivec3(0,0,0), -1});
+    m_pointCells.resize(count);
+    m_next.resize(count);
+    m_parent.resize(count);
+
+    const float scale = 0.5f / radius;
+
+    for(int i = 0; i < count; i++)
+    {
+        ivec3 cell(std::floor(points[i].x * scale), std::floor(points[i].y * scale), std::floor(points[i].z * scale));
+        Slot &s = m_table[slot(cell)];
+
+        s.m_cell = cell;
+        m_next[i] = s.m_head;
+        s.m_head = i;
+        m_pointCells[i] = cell;
+        m_parent[i] = i;
+    }
+
+    const float radius2 = radius * radius;
+
+    for(int i = 0; i < count; i++)
+    {
+        const ivec3 &cell = m_pointCells[i];
+
+        //nearer neighbour cell along every axis, point in lower half of its cell looks down
+        ivec3 side(points[i].x * scale - cell.x < 0.5f ? -1 : 1,
+                   points[i].y * scale - cell.y < 0.5f ? -1 : 1,
+                   points[i].z * scale - cell.z < 0.5f ? -1 : 1);
+
+        for(int n = 0; n < 8; n++)
+        {
+            ivec3 neighbour = cell + ivec3(n & 1 ? side.x : 0, n & 2 ? side.y : 0, n & 4 ? side.z : 0);
+
+            //each pair is tested once, from its later point
+            for(int j = m_table[slot(neighbour)].m_head; j != -1; j = m_next[j])
+            {
+                vec3 d = points[j] - points[i];
+
+                if(j < i && glm::dot(d, d) < radius2)
+                {
+                    int a = find(i), b = find(j);
+                    m_parent[std::max(a, b)] = std::min(a, b);
+                }
+            }
+        }
+    }
+
+    m_sums.assign(count, vec3(0,0,0));
+    m_weightSums.assign(count, 0);
+
+    for(int i = 0; i < count; i++)
+    {
+        int root = find(i);
+        float weight = weights.size() == points.size() ? std::max(weights[i], 1e-3f) : 1.0f;
+
+        m_sums[root] += weight * points[i];
+        m_weightSums[root] += weight;
+    }
+
+    //roots are the first points of their groups, order of groups follows input
+    int welded = 0;
+
+    for(int i = 0; i < count; i++)
+    {
+        if(m_parent[i] == i)
+        {
+            points[welded++] = m_sums[i] / m_weightSums[i];
+        }
+    }
+
+    points.resize(welded);
+}
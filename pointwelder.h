@@ -0,0 +1,64 @@
+/*
+ *
+ * Copyright (C) 2014  Miroslav Krajicek, Faculty of Informatics Masaryk University (https://github.com/kaajo).
+ * All Rights Reserved.
+ *
+ * This file is part of WebCamCap.
+ *
+ * WebCamCap is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU LGPL version 3 as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WebCamCap is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU LGPL version 3
+ * along with WebCamCap. If not, see <http://www.gnu.org/licenses/lgpl-3.0.txt>.
+ *
+ */
+
+#ifndef POINTWELDER_H
+#define POINTWELDER_H
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+/**
+ * @brief merges points closer than radius, every group is replaced by its weighted average
+ *
+ * Points are put into uniform grid of cells with size of two radii, hashed by open addressing.
+ * Neighbours of point lie in its cell or in cells on the nearer side along every axis, so 8 cells are searched.
+ * Groups are joined by union-find.
+ */
+class PointWelder
+{
+    class Slot
+    {
+    public:
+        glm::ivec3 m_cell;
+        int m_head;     /// first point in cell, -1 for empty slot
+    };
+
+    std::vector<Slot> m_table;
+    std::vector<glm::ivec3> m_pointCells;
+    std::vector<int> m_next;            /// next point in the same cell
+    std::vector<int> m_parent;
+    std::vector<glm::vec3> m_sums;
+    std::vector<float> m_weightSums;
+
+    int find(int point);
+    int slot(glm::ivec3 cell) const;
+
+public:
+    /// weights can be empty, all points have the same weight then
+    void weld(std::vector<glm::vec3> &points, const std::vector<float> &weights, float radius);
+
+    /// bytes reserved by internal buffers
+    size_t capacity() const;
+};
+
+#endif // POINTWELDER_H
@@ -0,0 +1,248 @@
+/*
+ *
+ * Copyright (C) 2014  Miroslav Krajicek, Faculty of Informatics Masaryk University (https://github.com/kaajo).
+ * All Rights Reserved.
+ *
+ * This file is part of WebCamCap.
+ *
+ * WebCamCap is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU LGPL version 3 as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WebCamCap is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU LGPL version 3
+ * along with WebCamCap. If not, see <http://www.gnu.org/licenses/lgpl-3.0.txt>.
+ *
+ */
+
+#include "raybatch.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define RAY_KERNEL_AVX2
+#include <immintrin.h>
+#endif
+
+using glm::vec3;
+
+typedef int (*RayKernel)(const Line &ray, int rayIndex, const RayBatch &batch, int begin, int end, float maxError, std::vector<RayHit> &hits);
+
+void RayBatch::set(const QVector<Line> &lines, float margin)
+{
+    std::vector<std::pair<float, int>> order(lines.size());
+
+    for(int i = 0; i < lines.size(); i++)
+    {
+        order[i] = {0.0f, i};
+    }
+
+    set(lines, order, margin);
+}
+
+void RayBatch::set(const QVector<Line> &lines, const std::vector<std::pair<float, int>> &sorted, float margin)
+{
+    m_size = sorted.size();
+
+    for(std::vector<float> *array: {&m_px, &m_py, &m_pz, &m_dx, &m_dy, &m_dz, &m_dd, &m_dp, &m_tmin, &m_tmax})
+    {
+        array->assign(m_size + padding, 0.0f);
+    }
+
+    m_index.resize(m_size);
+
+    for(int i = 0; i < m_size; i++)
+    {
+        const Line &line = lines[sorted[i].second];
+        const vec3 &p = line.m_position;
+        const vec3 &d = line.m_directionVector;
+
+        m_px[i] = p.x; m_py[i] = p.y; m_pz[i] = p.z;
+        m_dx[i] = d.x; m_dy[i] = d.y; m_dz[i] = d.z;
+        m_dd[i] = glm::dot(d, d);
+        m_dp[i] = glm::dot(d, p);
+        m_index[i] = sorted[i].second;
+
+        float slack = m_dd[i] > 0 ? margin / std::sqrt(m_dd[i]) : 0.0f;
+        m_tmin[i] = line.m_tmin - slack;
+        m_tmax[i] = line.m_tmax + slack;
+    }
+}
+
+//closest points are p1 + s d1 and p2 + t d2, both kernels evaluate the same expressions
+static inline void segment(const Line &ray, float maxError, float &tmin, float &tmax)
+{
+    float length = glm::length(ray.m_directionVector);
+    float slack = length > 0 ? maxError / length : 0.0f;
+
+    tmin = ray.m_tmin - slack;
+    tmax = ray.m_tmax + slack;
+}
+
+static inline void addHit(const Line &ray, int rayIndex, const RayBatch &batch, int j, float s, float t, float distance2, std::vector<RayHit> &hits)
+{
+    vec3 point1 = ray.m_position + ray.m_directionVector * s;
+    vec3 point2 = vec3(batch.m_px[j] + batch.m_dx[j] * t, batch.m_py[j] + batch.m_dy[j] * t, batch.m_pz[j] + batch.m_dz[j] * t);
+
+    hits.push_back({rayIndex, batch.m_index[j], (point1 + point2) * 0.5f, std::sqrt(distance2)});
+}
+
+static int intersectScalar(const Line &ray, int rayIndex, const RayBatch &batch, int begin, int end, float maxError, std::vector<RayHit> &hits)
+{
+    const vec3 p1 = ray.m_position, d1 = ray.m_directionVector;
+    const float a = glm::dot(d1, d1);
+    const float d1p1 = glm::dot(d1, p1);
+    const float maxError2 = maxError * maxError;
+
+    float tmin, tmax;
+    segment(ray, maxError, tmin, tmax);
+
+    int culled = 0;
+
+    for(int j = begin; j < end; j++)
+    {
+        float b = d1.x * batch.m_dx[j] + d1.y * batch.m_dy[j] + d1.z * batch.m_dz[j];
+        float e = batch.m_dd[j];
+        float denominator = a*e - b*b;
+
+        //c = d1 . (p1 - p2), f = d2 . (p1 - p2)
+        float c = d1p1 - (d1.x * batch.m_px[j] + d1.y * batch.m_py[j] + d1.z * batch.m_pz[j]);
+        float f = (batch.m_dx[j] * p1.x + batch.m_dy[j] * p1.y + batch.m_dz[j] * p1.z) - batch.m_dp[j];
+
+        float s = denominator != 0 ? (b*f - c*e) / denominator : 0.0f;
+        float t = denominator != 0 ? (a*f - c*b) / denominator : 0.0f;
+
+        float x = p1.x - batch.m_px[j] + s * d1.x - t * batch.m_dx[j];
+        float y = p1.y - batch.m_py[j] + s * d1.y - t * batch.m_dy[j];
+        float z = p1.z - batch.m_pz[j] + s * d1.z - t * batch.m_dz[j];
+        float distance2 = x*x + y*y + z*z;
+
+        if(distance2 < maxError2)
+        {
+            if(s < tmin || s > tmax || t < batch.m_tmin[j] || t > batch.m_tmax[j])
+            {
+                ++culled;
+                continue;
+            }
+
+            addHit(ray, rayIndex, batch, j, s, t, distance2, hits);
+        }
+    }
+
+    return culled;
+}
+
+#ifdef RAY_KERNEL_AVX2
+
+__attribute__((target("avx2,fma")))
+static int intersectAVX2(const Line &ray, int rayIndex, const RayBatch &batch, int begin, int end, float maxError, std::vector<RayHit> &hits)
+{
+    const vec3 p1 = ray.m_position, d1 = ray.m_directionVector;
+
+    const __m256 p1x = _mm256_set1_ps(p1.x), p1y = _mm256_set1_ps(p1.y), p1z = _mm256_set1_ps(p1.z);
+    const __m256 d1x = _mm256_set1_ps(d1.x), d1y = _mm256_set1_ps(d1.y), d1z = _mm256_set1_ps(d1.z);
+    const __m256 a = _mm256_set1_ps(glm::dot(d1, d1));
+    const __m256 d1p1 = _mm256_set1_ps(glm::dot(d1, p1));
+    const __m256 maxError2 = _mm256_set1_ps(maxError * maxError);
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+
+    float tmin1, tmax1;
+    segment(ray, maxError, tmin1, tmax1);
+
+    const __m256 vtmin1 = _mm256_set1_ps(tmin1), vtmax1 = _mm256_set1_ps(tmax1);
+
+    alignas(32) float s[8], t[8], distance2[8];
+    int culled = 0;
+
+    for(int j = begin; j < end; j += 8)
+    {
+        __m256 p2x = _mm256_loadu_ps(&batch.m_px[j]), p2y = _mm256_loadu_ps(&batch.m_py[j]), p2z = _mm256_loadu_ps(&batch.m_pz[j]);
+        __m256 d2x = _mm256_loadu_ps(&batch.m_dx[j]), d2y = _mm256_loadu_ps(&batch.m_dy[j]), d2z = _mm256_loadu_ps(&batch.m_dz[j]);
+        __m256 e = _mm256_loadu_ps(&batch.m_dd[j]);
+
+        __m256 b = _mm256_fmadd_ps(d1z, d2z, _mm256_fmadd_ps(d1y, d2y, _mm256_mul_ps(d1x, d2x)));
+        __m256 denominator = _mm256_fmsub_ps(a, e, _mm256_mul_ps(b, b));
+
+        __m256 c = _mm256_sub_ps(d1p1, _mm256_fmadd_ps(d1z, p2z, _mm256_fmadd_ps(d1y, p2y, _mm256_mul_ps(d1x, p2x))));
+        __m256 f = _mm256_sub_ps(_mm256_fmadd_ps(d2z, p1z, _mm256_fmadd_ps(d2y, p1y, _mm256_mul_ps(d2x, p1x))), _mm256_loadu_ps(&batch.m_dp[j]));
+
+        //parallel rays keep their positions as closest points
+        __m256 notParallel = _mm256_cmp_ps(denominator, zero, _CMP_NEQ_OQ);
+        __m256 vs = _mm256_and_ps(notParallel, _mm256_div_ps(_mm256_fmsub_ps(b, f, _mm256_mul_ps(c, e)), denominator));
+        __m256 vt = _mm256_and_ps(notParallel, _mm256_div_ps(_mm256_fmsub_ps(a, f, _mm256_mul_ps(c, b)), denominator));
+
+        __m256 x = _mm256_fnmadd_ps(vt, d2x, _mm256_fmadd_ps(vs, d1x, _mm256_sub_ps(p1x, p2x)));
+        __m256 y = _mm256_fnmadd_ps(vt, d2y, _mm256_fmadd_ps(vs, d1y, _mm256_sub_ps(p1y, p2y)));
+        __m256 z = _mm256_fnmadd_ps(vt, d2z, _mm256_fmadd_ps(vs, d1z, _mm256_sub_ps(p1z, p2z)));
+        __m256 vDistance2 = _mm256_fmadd_ps(z, z, _mm256_fmadd_ps(y, y, _mm256_mul_ps(x, x)));
+
+        //lanes past end are masked out
+        __m256 accepted = _mm256_cmp_ps(vDistance2, maxError2, _CMP_LT_OQ);
+        __m256i inside = _mm256_cmpgt_epi32(_mm256_set1_epi32(end - j), lanes);
+
+        int mask = _mm256_movemask_ps(_mm256_and_ps(accepted, _mm256_castsi256_ps(inside)));
+
+        if(!mask)
+        {
+            continue;
+        }
+
+        __m256 onSegments = _mm256_and_ps(_mm256_and_ps(_mm256_cmp_ps(vs, vtmin1, _CMP_GE_OQ), _mm256_cmp_ps(vs, vtmax1, _CMP_LE_OQ)),
+                                          _mm256_and_ps(_mm256_cmp_ps(vt, _mm256_loadu_ps(&batch.m_tmin[j]), _CMP_GE_OQ),
+                                                        _mm256_cmp_ps(vt, _mm256_loadu_ps(&batch.m_tmax[j]), _CMP_LE_OQ)));
+
+        int segmentMask = _mm256_movemask_ps(onSegments);
+
+        culled += __builtin_popcount(mask & ~segmentMask);
+        mask &= segmentMask;
+
+        _mm256_store_ps(s, vs);
+        _mm256_store_ps(t, vt);
+        _mm256_store_ps(distance2, vDistance2);
+
+        for(; mask; mask &= mask - 1)
+        {
+            int lane = __builtin_ctz(mask);
+            addHit(ray, rayIndex, batch, j + lane, s[lane], t[lane], distance2[lane], hits);
+        }
+    }
+
+    return culled;
+}
+
+#endif
+
+static RayKernel selectKernel()
+{
+#ifdef RAY_KERNEL_AVX2
+    if(__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+    {
+        return intersectAVX2;
+    }
+#endif
+
+    return intersectScalar;
+}
+
+static const RayKernel rayKernel = selectKernel();
+
+int intersectRays(const Line &ray, int rayIndex, const RayBatch &batch, int begin, int end, float maxError, std::vector<RayHit> &hits)
+{
+    return rayKernel(ray, rayIndex, batch, begin, end, maxError, hits);
+}
+
+const char *intersectRaysKernel()
+{
+#ifdef RAY_KERNEL_AVX2
+    if(rayKernel == intersectAVX2)
+    {
+        return "AVX2";
+    }
+#endif
+
+    return "scalar";
+}
@@ -0,0 +1,77 @@
+/*
+ *
+ * Copyright (C) 2014  Miroslav Krajicek, Faculty of Informatics Masaryk University (https://github.com/kaajo).
+ * All Rights Reserved.
+ *
+ * This file is part of WebCamCap.
+ *
+ * WebCamCap is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU LGPL version 3 as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WebCamCap is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU LGPL version 3
+ * along with WebCamCap. If not, see <http://www.gnu.org/licenses/lgpl-3.0.txt>.
+ *
+ */
+
+#ifndef RAYBATCH_H
+#define RAYBATCH_H
+
+#include "line.h"
+
+#include <utility>
+
+#include <QVector>
+
+/// lines stored as structure of arrays, squared direction length and direction . position precomputed
+class RayBatch
+{
+public:
+    std::vector<float> m_px, m_py, m_pz;
+    std::vector<float> m_dx, m_dy, m_dz;
+    std::vector<float> m_dd, m_dp;
+    std::vector<float> m_tmin, m_tmax;  /// segment in room, widened by margin
+    std::vector<int> m_index;   /// index of ray in source lines
+    int m_size = 0;
+
+    /// arrays are padded by one block of zero rays, kernel can read whole blocks past the end
+    static const int padding = 8;
+
+    /// margin in room units is added to both ends of segments
+    void set(const QVector<Line> &lines, float margin = 0);
+
+    /// rays in order of sorted (epipolar angle, index) pairs, so epipolar band is continuous range
+    void set(const QVector<Line> &lines, const std::vector<std::pair<float, int>> &sorted, float margin = 0);
+
+    int size() const {return m_size;}
+};
+
+class RayHit
+{
+public:
+    int m_first;        /// index of ray in first lines
+    int m_second;       /// index of ray in second lines
+    glm::vec3 m_point;  /// midpoint of closest points
+    float m_distance;   /// distance of closest points
+};
+
+/**
+ * @brief tests ray against rays [begin, end) of batch, pairs closer than maxError are appended to hits
+ *
+ * Same closest points as Line::Intersection, parallel rays meet at their positions.
+ * Closest points have to lie on segments of both rays (widened by maxError for ray, by margin of batch).
+ * Eight rays are tested at once with AVX2 if CPU supports it.
+ * @return number of pairs closer than maxError rejected because closest point was outside of segment
+ */
+int intersectRays(const Line &ray, int rayIndex, const RayBatch &batch, int begin, int end, float maxError, std::vector<RayHit> &hits);
+
+/// name of the kernel picked at runtime, for logs
+const char *intersectRaysKernel();
+
+#endif // RAYBATCH_H
@@ -0,0 +1,186 @@
+/*
+ *
+ * Copyright (C) 2014  Miroslav Krajicek, Faculty of Informatics Masaryk University (https://github.com/kaajo).
+ * All Rights Reserved.
+ *
+ * This file is part of WebCamCap.
+ *
+ * WebCamCap is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU LGPL version 3 as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WebCamCap is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU LGPL version 3
+ * along with WebCamCap. If not, see <http://www.gnu.org/licenses/lgpl-3.0.txt>.
+ *
+ */
+
+
+#include "rayrecording.h"
+#include "raybatch.h"
+
+#include <QDataStream>
+#include <QFile>
+#include <QSaveFile>
+
+static const quint32 recordingMagic = 0x57435252; //WCRR
+static const quint32 recordingVersion = 2;
+
+static void writeVector(QDataStream &out, const glm::vec3 &vector)
+{
+    out << vector.x << vector.y << vector.z;
+}
+
+static void readVector(QDataStream &in, glm::vec3 &vector)
+{
+    in >> vector.x >> vector.y >> vector.z;
+}
+
+void RayRecording::clear()
+{
+    m_kernel = intersectRaysKernel();
+    m_frames.clear();
+}
+
+void RayRecording::addFrame(const QVector<QVector<Line>> &lines, const std::vector<glm::vec3> &points, bool multiView)
+{
+    m_frames.push_back({lines, points, multiView});
+}
+
+bool RayRecording::save(const QString &fileName) const
+{
+    QSaveFile file(fileName);
+
+    if(!file.open(QIODevice::WriteOnly))
+    {
+        return false;
+    }
+
+    //single precision keeps floats bitwise equal to the ones triangulation used
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_5_0);
+    out.setFloatingPointPrecision(QDataStream::SinglePrecision);
+
+    out << recordingMagic << recordingVersion << m_kernel << (quint64) m_frames.size();
+
+    for(const RayFrame &frame: m_frames)
+    {
+        out << frame.m_multiView << (quint32) frame.m_lines.size();
+
+        for(const QVector<Line> &lines: frame.m_lines)
+        {
+            out << (quint32) lines.size();
+
+            for(const Line &line: lines)
+            {
+                writeVector(out, line.m_position);
+                writeVector(out, line.m_directionVector);
+                out << line.m_tmin << line.m_tmax;
+            }
+        }
+
+        out << (quint32) frame.m_points.size();
+
+        for(const glm::vec3 &point: frame.m_points)
+        {
+            writeVector(out, point);
+        }
+    }
+
+    return out.status() == QDataStream::Ok && file.commit();
+}
+
+bool RayRecording::load(const QString &fileName)
+{
+    m_frames.clear();
+
+    QFile file(fileName);
+
+    if(!file.open(QIODevice::ReadOnly))
+    {
+        return false;
+    }
+
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_5_0);
+    in.setFloatingPointPrecision(QDataStream::SinglePrecision);
+
+    quint32 magic = 0, version = 0;
+    quint64 frames = 0;
+
+    in >> magic >> version >> m_kernel >> frames;
+
+    auto fail = [this]
+    {
+        m_frames.clear();
+        return false;
+    };
+
+    if(magic != recordingMagic || version != recordingVersion)
+    {
+        return fail();
+    }
+
+    for(quint64 f = 0; f < frames && in.status() == QDataStream::Ok; f++)
+    {
+        RayFrame frame;
+        quint32 cameras = 0, count = 0;
+
+        in >> frame.m_multiView >> cameras;
+
+        if(cameras > file.bytesAvailable())
+        {
+            return fail();
+        }
+
+        frame.m_lines.resize(cameras);
+
+        for(quint32 i = 0; i < cameras && in.status() == QDataStream::Ok; i++)
+        {
+            in >> count;
+
+            //damaged file must not allocate more than it can contain
+            if(count > file.bytesAvailable())
+            {
+                return fail();
+            }
+
+            frame.m_lines[i].resize(count);
+
+            for(Line &line: frame.m_lines[i])
+            {
+                readVector(in, line.m_position);
+                readVector(in, line.m_directionVector);
+                in >> line.m_tmin >> line.m_tmax;
+            }
+        }
+
+        in >> count;
+
+        if(count > file.bytesAvailable())
+        {
+            return fail();
+        }
+
+        frame.m_points.resize(count);
+
+        for(glm::vec3 &point: frame.m_points)
+        {
+            readVector(in, point);
+        }
+
+        m_frames.push_back(frame);
+    }
+
+    if(in.status() != QDataStream::Ok)
+    {
+        return fail();
+    }
+
+    return true;
+}
@@ -0,0 +1,67 @@
+/*
+ *
+ * Copyright (C) 2014  Miroslav Krajicek, Faculty of Informatics Masaryk University (https://github.com/kaajo).
+ * All Rights Reserved.
+ *
+ * This file is part of WebCamCap.
+ *
+ * WebCamCap is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU LGPL version 3 as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WebCamCap is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU LGPL version 3
+ * along with WebCamCap. If not, see <http://www.gnu.org/licenses/lgpl-3.0.txt>.
+ *
+ */
+
+
+#ifndef RAYRECORDING_H
+#define RAYRECORDING_H
+
+#include "line.h"
+
+#include <QString>
+#include <QVector>
+
+#include <vector>
+
+/// rays of all cameras in one fused frame and points triangulated from them
+class RayFrame
+{
+public:
+    QVector<QVector<Line>> m_lines;
+    std::vector<glm::vec3> m_points;
+    bool m_multiView;   /// points come from Triangulator, not from pairwise edges
+};
+
+/**
+ * @brief rays recorded during fusion, replayed through triangulation without cameras
+ *
+ * Points are stored bitwise, replay of the same rays has to give exactly them again.
+ * Triangulation mode of every frame and name of ray kernel are stored too,
+ * points of other mode or other kernel are not expected to be equal.
+ */
+class RayRecording
+{
+    QString m_kernel;
+    std::vector<RayFrame> m_frames;
+
+public:
+    void clear();
+    void addFrame(const QVector<QVector<Line>> &lines, const std::vector<glm::vec3> &points, bool multiView);
+
+    size_t size() const {return m_frames.size();}
+    const RayFrame &frame(size_t index) const {return m_frames[index];}
+    QString kernel() const {return m_kernel;}
+
+    bool save(const QString &fileName) const;
+    bool load(const QString &fileName);
+};
+
+#endif // RAYRECORDING_H
@@ -21,11 +21,16 @@
  */
 
 #include "room.h"
+#include "allocationcounter.h"
 
 #include <QVariant>
 #include <QVariantMap>
 #include <QApplication>
 #include <QtConcurrent/QtConcurrent>
+#include <QElapsedTimer>
+
+#include <algorithm>
+#include <map>
 
 using glm::vec2;
 using glm::vec3;
@@ -55,6 +60,20 @@ Room::Room(OpenGLWindow *opengl, vec3 dimensions, float eps, QString name)
     m_activeCamerasCount = 0;
     m_lastActiveCamIndex = 0;
 
+    //threads of the pool are kept between frames instead of expiring
+    m_intersectionPool.setMaxThreadCount(QThread::idealThreadCount());
+    m_intersectionPool.setExpiryTimeout(-1);
+
+    m_fusionThread = new FusionThread([this] {return fuseObservations();});
+    updateFusionSettings(true);
+
+    m_finishedFrames.resize(finishedSlots);
+    m_shownFrames.resize(finishedSlots);
+
+    //display rate, triangulation runs at camera rate in fusion thread
+    m_frameTimer.setInterval(16);
+    connect(&m_frameTimer, SIGNAL(timeout()), this, SLOT(showFrames()));
+
     server = new QLocalServer();
     server->setMaxPendingConnections(1);
 }
@@ -75,6 +94,13 @@ Room::~Room()
         delete(m_cameras[i]);
     }
 
+    delete m_fusionThread;
+
+    for(size_t i = 0; i < m_observationQueues.size(); i++)
+    {
+        delete m_observationQueues[i];
+    }
+
     for(size_t i = 0; i < animations.size(); i++)
     {
         delete(animations[i]);
@@ -88,6 +114,14 @@ Room::~Room()
 
 void Room::AddCamera(CaptureCamera *cam)
 {
+    //fusion reads cameras, rings and assembler, it waits while they change
+    bool fusing = m_fusionThread->isRunning();
+
+    if(fusing)
+    {
+        m_fusionThread->stop();
+    }
+
     m_cameras.push_back(cam);
 
     if(cam->getTurnedOn())
@@ -98,10 +132,16 @@ void Room::AddCamera(CaptureCamera *cam)
 
     m_saved = false;
 
-    haveResults.push_back(false);
     results.push_back(QVector<Line>());
+    m_assembler.setCameraCount(m_cameras.size());
 
-    workers.push_back(new worker(&allLines, cam));
+    m_observationQueues.push_back(new ObservationQueue());
+
+    //worker copies lines into slots, they are sized once from configuration of camera
+    int maxBlobs = cam->maxBlobs();
+    m_observationQueues.back()->forEachSlot([maxBlobs](ObservationRecord &record) {record.m_lines.resize(maxBlobs);});
+
+    workers.push_back(new worker(cam, m_observationQueues.back()));
     workerthreads.push_back(new QThread);
 
     workers[workers.size()-1]->moveToThread(workerthreads[workerthreads.size()-1]);
@@ -110,7 +150,6 @@ void Room::AddCamera(CaptureCamera *cam)
     connect( this, SIGNAL(startWork2D()), this, SLOT(record2D()));
     connect( this, SIGNAL(startWork()), workers[workers.size()-1], SLOT(StartWork()));
     connect( this, SIGNAL(stopWork()), workers[workers.size()-1], SLOT(StopWork()));
-    connect(workers[workers.size()-1],SIGNAL(ResultReady(QVector<Line>)),this,SLOT(ResultReady(QVector<Line>)), Qt::QueuedConnection);
 
     connect(workers[workers.size()-1], SIGNAL(finished()), workerthreads[workers.size()-1], SLOT(quit()));
     connect(workers[workers.size()-1], SIGNAL(finished()), workers[workers.size()-1], SLOT(deleteLater()));
@@ -118,12 +157,20 @@ void Room::AddCamera(CaptureCamera *cam)
 
     workerthreads[workerthreads.size()-1]->start();
 
-    MakeTopology();
+    updateFusionSettings(true);
+
+    if(fusing)
+    {
+        m_fusionThread->start();
+    }
 }
 
 void Room::setDimensions(vec3 dims)
 {
-    m_roomDimensions = dims;
+    {
+        QMutexLocker l(&m_settingsMutex);
+        m_roomDimensions = dims;
+    }
 
     for(size_t i = 0; i < m_cameras.size(); i++)
     {
@@ -131,21 +178,139 @@ void Room::setDimensions(vec3 dims)
     }
 
     m_saved = false;
+
+    updateFusionSettings(true);
 }
 
 void Room::setEpsilon(float size)
 {
-    m_maxError = size;
+    {
+        QMutexLocker l(&m_settingsMutex);
+        m_maxError = size;
+    }
+
+    m_saved = false;
+
+    updateFusionSettings(false);
+}
+
+void Room::setTopologyPairs(int pairs)
+{
+    {
+        QMutexLocker l(&m_settingsMutex);
+        m_topologyPairs = pairs;
+    }
+
     m_saved = false;
+
+    updateFusionSettings(true);
+}
+
+void Room::setEpipolarTolerance(float degrees)
+{
+    {
+        QMutexLocker l(&m_settingsMutex);
+        m_epipolarTolerance = degrees;
+    }
+
+    m_saved = false;
+
+    updateFusionSettings(false);
+}
+
+void Room::setMultiView(bool multiView)
+{
+    {
+        QMutexLocker l(&m_settingsMutex);
+        m_multiView = multiView;
+    }
+
+    m_saved = false;
+
+    updateFusionSettings(false);
 }
 
 void Room::setNumberOfPoints(size_t nOfPts)
 {
-    checker.setNumOfPoints(nOfPts);
+    {
+        QMutexLocker l(&m_settingsMutex);
+        m_numberOfPoints = nOfPts;
+    }
+
+    updateFusionSettings(false);
+}
+
+void Room::updateFusionSettings(bool topology)
+{
+    {
+        QMutexLocker l(&m_settingsMutex);
+
+        m_settingsChanged = true;
+        m_topologyChanged = m_topologyChanged || topology;
+    }
+
+    //stopped fusion reads nothing, its copy is updated right away
+    if(!m_fusionThread->isRunning())
+    {
+        applySettings();
+    }
+}
+
+void Room::applySettings()
+{
+    bool topology;
+
+    {
+        QMutexLocker l(&m_settingsMutex);
+
+        if(!m_settingsChanged)
+        {
+            return;
+        }
+
+        m_fusion.m_roomDimensions = m_roomDimensions;
+        m_fusion.m_maxError = m_maxError;
+        m_fusion.m_epipolarTolerance = m_epipolarTolerance;
+        m_fusion.m_topologyPairs = m_topologyPairs;
+        m_fusion.m_multiView = m_multiView;
+        m_fusion.m_numberOfPoints = m_numberOfPoints;
+
+        topology = m_topologyChanged;
+        m_settingsChanged = m_topologyChanged = false;
+    }
+
+    checker.setNumOfPoints(m_fusion.m_numberOfPoints);
+
+    if(topology)
+    {
+        MakeTopology();
+    }
+    else
+    {
+        setEdgeSettings();
+    }
+}
+
+void Room::setEdgeSettings()
+{
+    //rays near baseline depend on max error
+    for(size_t i = 0; i < m_cameraTopology.size(); i++)
+    {
+        Edge &edge = m_cameraTopology[i];
+        edge.m_maxError = m_fusion.m_maxError;
+        edge.m_epipolar.set(m_cameras[edge.m_index1]->getPosition(), m_cameras[edge.m_index2]->getPosition(), m_fusion.m_epipolarTolerance, m_fusion.m_maxError);
+    }
 }
 
 void Room::RemoveCamera(size_t index)
 {
+    bool fusing = m_fusionThread->isRunning();
+
+    if(fusing)
+    {
+        m_fusionThread->stop();
+    }
+
     if(m_cameras[index]->getTurnedOn())
     {
         m_activeCamerasCount--;
@@ -163,55 +328,49 @@ void Room::RemoveCamera(size_t index)
 
     HideCameraVideo(index);
     TurnOffCamera(index);
+
+    //worker leaves its loop and thread, its ring is deleted after nobody writes into it
+    workers[index]->StopWork();
+    workerthreads[index]->quit();
+    workerthreads[index]->wait();
+
+    delete workers[index];
+    delete workerthreads[index];
+    delete m_observationQueues[index];
+
+    workers.erase(workers.begin() + index);
+    workerthreads.erase(workerthreads.begin() + index);
+    m_observationQueues.erase(m_observationQueues.begin() + index);
+    results.erase(results.begin() + index);
+    m_assembler.removeCamera(index);
+
     m_cameras.erase(m_cameras.begin()+index);
     m_saved = false;
 
-    MakeTopology();
+    updateFusionSettings(true);
+
+    if(fusing)
+    {
+        m_fusionThread->start();
+    }
 }
 
 void Room::MakeTopology()
 {
     m_cameraTopology.clear();
 
-    vec3 pos1, pos2;
-    vec3 dir1, dir2;
-    cv::Mat intr1, intr2;
-
-    float min = 181.0f, temp_angle;
-    int min_index = -1;
+    //overlap is computed once here, frames only fill rays of edges
+    std::vector<CameraPair> pairs = CameraTopology::select(CameraTopology::score(m_cameras, m_fusion.m_roomDimensions), m_cameras.size(), m_fusion.m_topologyPairs);
 
-    //get
-    for(size_t i = 0; i < m_cameras.size(); i++)
+    for(const CameraPair &pair: pairs)
     {
+        Edge edge(pair.m_index1, pair.m_index2, m_fusion.m_maxError);
+        edge.m_epipolar.set(m_cameras[pair.m_index1]->getPosition(), m_cameras[pair.m_index2]->getPosition(), m_fusion.m_epipolarTolerance, m_fusion.m_maxError);
 
-        pos1 = m_cameras[i]->getPosition();
-        dir1 = m_cameras[i]->getDirVector();
-        intr1 = m_cameras[i]->cameraMatrix();
+        m_cameraTopology.push_back(edge);
 
-        for(size_t j = i+1; j < m_cameras.size(); j++)
-        {
-
-            pos2 = m_cameras[j]->getPosition();
-            dir2 = m_cameras[j]->getDirVector();
-            intr2 = m_cameras[j]->cameraMatrix();
-
-            temp_angle = Line::LineAngle(vec2(dir1.x, dir1.y),vec2(dir2.x, dir2.y));
-
-            if(glm::abs(temp_angle) < min)
-            {
-                min = temp_angle;
-                min_index = j;
-            }
-        }
-
-        if(min_index != -1)
-        {
-            Edge edge(i,min_index, m_maxError);
-            //edge.setFundamentalMatrix(pos1, dir1, intr1, pos2, dir2, intr2);
-
-            m_cameraTopology.push_back(edge);
-
-        }
+        std::cout << "camera pair " << pair.m_index1 << "-" << pair.m_index2 << ": overlap " << pair.m_overlap * 100 << "%, convergence "
+                  << pair.m_convergence << " deg, baseline " << pair.m_baseline << ", score " << pair.m_score << std::endl;
     }
 
     resolveTopologyDuplicates();
@@ -226,13 +385,13 @@ void Room::resolveTopologyDuplicates()
         size_t index1 = m_cameraTopology[i].m_index1;
         size_t index2 = m_cameraTopology[i].m_index2;
 
-        for(size_t j = 0; j < m_cameraTopology.size(); j++)
+        //only later edges are removed, erasing while iterating skipped the edge after every erased one
+        auto duplicate = [&](const Edge &edge)
         {
-            if(m_cameraTopology[j].m_index1 == index2 && m_cameraTopology[j].m_index2 == index1)
-            {
-                m_cameraTopology.erase(m_cameraTopology.begin()+j);
-            }
-        }
+            return (edge.m_index1 == index1 && edge.m_index2 == index2) || (edge.m_index1 == index2 && edge.m_index2 == index1);
+        };
+
+        m_cameraTopology.erase(std::remove_if(m_cameraTopology.begin() + i + 1, m_cameraTopology.end(), duplicate), m_cameraTopology.end());
     }
 }
 
@@ -304,16 +463,40 @@ Animation *Room::CaptureAnimationStop()
 void Room::RecordingStart()
 {
     m_record = true;
+    m_lastFrameTimestamp = 0;
 
     if(m_activeCamerasCount > 1)
     {
-        timer.start();
+        m_assembler.clear();
+        m_truncatedObservations = 0;
+        m_truncatedLines = 0;
+
+        for(size_t i = 0; i < m_cameras.size(); i++)
+        {
+            m_assembler.setActive(i, m_cameras[i]->getTurnedOn());
+        }
+
+        //observations left from last recording, fusion thread is not running so this thread may consume
+        for(size_t i = 0; i < m_observationQueues.size(); i++)
+        {
+            while(m_observationQueues[i]->front())
+            {
+                m_observationQueues[i]->pop();
+            }
+        }
+
+        if(!m_rayRecordingFile.isEmpty())
+        {
+            startRayRecording();
+        }
+
+        m_fusionThread->start();
+        m_frameTimer.start();
 
         emit startWork();
     }
     else if(m_activeCamerasCount == 1)
     {
-        timer.start();
         m_openGLWindow->setTwoDimensions(true);
         emit startWork2D();
     }
@@ -322,8 +505,40 @@ void Room::RecordingStart()
 void Room::RecordingStop()
 {
     m_record = false;
-    m_openGLWindow->setTwoDimensions(false);
+
+    if(m_openGLWindow)
+    {
+        m_openGLWindow->setTwoDimensions(false);
+    }
+
     emit stopWork();
+
+    if(m_fusionThread->isRunning())
+    {
+        m_fusionThread->stop();
+        m_frameTimer.stop();
+
+        showFrames();
+    }
+
+    if(m_recordRays)
+    {
+        saveRayRecording(m_rayRecordingFile);
+    }
+
+    if(m_assembler.assembled() > 0)
+    {
+        size_t rejected = 0;
+
+        for(size_t i = 0; i < m_observationQueues.size(); i++)
+        {
+            rejected += m_observationQueues[i]->rejected();
+        }
+
+        std::cout << "assembled frames: " << m_assembler.assembled() << " skipped observations: " << m_assembler.skipped()
+                  << " full rings: " << rejected << " truncated observations: " << m_truncatedObservations
+                  << " (" << m_truncatedLines << " rays over maxBlobs) frames not shown: " << m_unshownFrames << std::endl;
+    }
 }
 /*
 void Room::Save(std::ofstream &file)
@@ -343,69 +558,125 @@ void Room::Save(std::ofstream &file)
 }
 */
 
-void Room::ResultReady(QVector<Line> lines)
+bool Room::fuseObservations()
 {
-    waitKey(1);
+    //settings of GUI are taken between frames, setters never wait for triangulation
+    applySettings();
 
-    QObject *obj = QObject::sender();
+    bool received = false;
 
-    for(size_t i = 0; i < workers.size(); i++)
+    for(size_t i = 0; i < m_observationQueues.size(); i++)
     {
-        if(obj == workers[i])
+        while(ObservationRecord *record = m_observationQueues[i]->front())
         {
-            if(haveResults[i])
+            if(record->m_truncated > 0)
             {
-                std::cout << "bad sync" << std::endl;
+                ++m_truncatedObservations;
+                m_truncatedLines += record->m_truncated;
             }
 
-            haveResults[i] = true;
-            for(size_t j = 0; j < m_cameraTopology.size(); j++)
-            {
-                if(m_cameraTopology[j].m_index1 == i)
-                {
-                    m_cameraTopology[j].a = lines;
-                }
+            m_assembler.addObservation(i, *record);
+            m_observationQueues[i]->pop();
 
-                if(m_cameraTopology[j].m_index2 == i)
-                {
-                    m_cameraTopology[j].b = lines;
-                }
+            received = true;
+        }
+    }
 
-                results[i] = lines;
-            }
+    while(m_assembler.assemble(m_fusionFrame))
+    {
+        //buffers are exchanged, both stay unshared and keep their storage
+        results.swap(m_fusionFrame.m_lines);
+        setEdgeRays();
+
+        updateFrameTime(m_fusionFrame.m_timestamp);
+
+        points.clear();
 
-            break;
+        Intersections();
+
+        QMutexLocker f(&m_finishedMutex);
+
+        //GUI stalled, oldest frame is overwritten
+        if(m_finishedCount == m_finishedFrames.size())
+        {
+            m_finishedFirst = (m_finishedFirst + 1) % m_finishedFrames.size();
+            --m_finishedCount;
+            ++m_unshownFrames;
+        }
+
+        //assignments reuse storage of slot, lines shown in window or animation are shared and detach once
+        FusedFrame &finished = m_finishedFrames[(m_finishedFirst + m_finishedCount++) % m_finishedFrames.size()];
+
+        finished.m_elapsed = m_frameElapsed;
+        finished.m_points = points;
+        finished.m_labeledPoints = labeledPoints;
+        finished.m_lines.resize(results.size());
+
+        for(int i = 0; i < results.size(); i++)
+        {
+            copyLines(results[i], finished.m_lines[i]);
+        }
+
+        if(m_fusion.m_multiView)
+        {
+            finished.m_triangulatedPoints = m_triangulatedPoints;
+        }
+        else
+        {
+            finished.m_triangulatedPoints.clear();
         }
     }
 
-    for(size_t i = 0; i < workers.size(); i++)
+    return received;
+}
+
+void Room::showFrames()
+{
+    waitKey(1);
+
+    size_t shown;
+
     {
-        if(!haveResults[i])
+        QMutexLocker l(&m_finishedMutex);
+
+        //slots are exchanged, fusion gets back storage of frames shown last time
+        for(shown = 0; shown < m_finishedCount; shown++)
         {
-            return;
+            std::swap(m_finishedFrames[(m_finishedFirst + shown) % m_finishedFrames.size()], m_shownFrames[shown]);
         }
+
+        m_finishedFirst = m_finishedCount = 0;
     }
 
-    points.clear();
+    //every frame goes to pipe and animation, window shows only the newest one
+    for(size_t i = 0; i < shown; i++)
+    {
+        if(m_usePipe)
+        {
+            sendMessage(m_shownFrames[i].m_points);
+        }
 
-    Intersections();
+        if(m_captureAnimation)
+        {
+            actualAnimation->AddFrame(Frame(m_shownFrames[i].m_elapsed, m_shownFrames[i].m_labeledPoints, m_shownFrames[i].m_lines));
+        }
+    }
 
-    if(m_usePipe)
+    if(shown > 0)
     {
-        sendMessage(points);
+        m_shownTriangulatedPoints.swap(m_shownFrames[shown - 1].m_triangulatedPoints);
     }
-/*
-    for(size_t i = 0; i < points.size(); i++)
+
+    if(shown > 0 && m_openGLWindow)
     {
-        std::cout << points[i] << std::endl;
+        m_openGLWindow->setFrame(m_shownFrames[shown - 1].m_labeledPoints, m_shownFrames[shown - 1].m_lines);
     }
-*/
-    //std::cout << timer.elapsed() << std::endl;
-
+}
 
-    timer.restart();
-    allLines.wakeAll();
-    QCoreApplication::processEvents();
+void Room::updateFrameTime(qint64 timestamp)
+{
+    m_frameElapsed = m_lastFrameTimestamp == 0 ? 0 : (timestamp - m_lastFrameTimestamp) / 1000;
+    m_lastFrameTimestamp = timestamp;
 }
 
 void Room::sendMessage(std::vector<vec3> Points)
@@ -462,59 +733,386 @@ void Room::sendMessage(string str)
 
 void Room::Intersection(Edge &camsEdge)
 {
-    vec3 tempPoint;
+    camsEdge.m_hits.clear();
+    camsEdge.m_culledPairs = 0;
+
+    //points may lie maxError outside of room, segments of rays are widened by it
+    if(!camsEdge.m_epipolar.valid())
+    {
+        camsEdge.m_batchB.set(camsEdge.b, camsEdge.m_maxError);
 
-     for(size_t i = 0; i < camsEdge.a.size(); i++)
-     {
-         for(size_t j = 0; j < camsEdge.b.size(); j++)
-         {
-             tempPoint = Line::Intersection(camsEdge.a[i], camsEdge.b[j], camsEdge.m_maxError);
+        for(int i = 0; i < camsEdge.a.size(); i++)
+        {
+            camsEdge.m_culledPairs += intersectRays(camsEdge.a[i], i, camsEdge.m_batchB, 0, camsEdge.m_batchB.size(), camsEdge.m_maxError, camsEdge.m_hits);
+        }
+    }
+    else
+    {
+        camsEdge.m_epipolar.sortByAngle(camsEdge.b, camsEdge.m_sortedB);
+        camsEdge.m_batchB.set(camsEdge.b, camsEdge.m_sortedB, camsEdge.m_maxError);
 
-             if(tempPoint != vec3(0,0,0))
-             {
-                camsEdge.points.push_back(tempPoint);
-             }
-         }
-     }
-    camsEdge.a.clear();
-    camsEdge.b.clear();
+        //only rays of second camera in epipolar band of the ray and rays near baseline are tested
+        for(int i = 0; i < camsEdge.a.size(); i++)
+        {
+            camsEdge.m_epipolar.forCandidateRanges(camsEdge.m_sortedB, camsEdge.a[i], [&](int begin, int end)
+            {
+                camsEdge.m_culledPairs += intersectRays(camsEdge.a[i], i, camsEdge.m_batchB, begin, end, camsEdge.m_maxError, camsEdge.m_hits);
+            });
+        }
+    }
+
+    camsEdge.a.resize(0);
+    camsEdge.b.resize(0);
 }
 
-void Room::Intersections()
+void Room::setEdgeRays()
 {
-    QtConcurrent::map(m_cameraTopology, Room::Intersection);
+    //copies, edges sharing results would make next frame detach them
+    for(size_t j = 0; j < m_cameraTopology.size(); j++)
+    {
+        copyLines(results[m_cameraTopology[j].m_index1], m_cameraTopology[j].a);
+        copyLines(results[m_cameraTopology[j].m_index2], m_cameraTopology[j].b);
+    }
+}
+
+void Room::Triangulate(std::vector<vec3> &triangulated)
+{
+    if(m_fusion.m_multiView)
+    {
+        m_triangulator.setMaxError(m_fusion.m_maxError);
+        m_triangulator.setEpipolarTolerance(m_fusion.m_epipolarTolerance);
+        m_triangulator.triangulate(results, m_triangulatedPoints);
+        m_culledPairs += m_triangulator.culledPairs();
+
+        for(size_t i = 0; i < m_triangulatedPoints.size(); i++)
+        {
+            triangulated.push_back(m_triangulatedPoints[i].m_position);
+        }
+
+        return;
+    }
+
+    m_intersectionFutures.resize(m_cameraTopology.size());
+
+    for(size_t i = 0; i < m_cameraTopology.size(); i++)
+    {
+        Edge *edge = &m_cameraTopology[i];
+        m_intersectionFutures[i] = QtConcurrent::run(&m_intersectionPool, [edge] {Room::Intersection(*edge);});
+    }
 
+    //edges are merged in topology order after all of them finished, points do not depend on scheduling
     for(size_t i = 0; i < m_cameraTopology.size(); i++)
     {
-        points.insert(points.end(), m_cameraTopology[i].points.begin(), m_cameraTopology[i].points.end());
-        m_cameraTopology[i].points.clear();
+        m_intersectionFutures[i].waitForFinished();
+        m_culledPairs += m_cameraTopology[i].m_culledPairs;
+
+        //closer rays give better point, weight is used when points of edges are welded
+        for(const RayHit &hit: m_cameraTopology[i].m_hits)
+        {
+            triangulated.push_back(hit.m_point);
+            m_pointWeights.push_back(1.0f - hit.m_distance / m_cameraTopology[i].m_maxError);
+        }
     }
 
-    //weld points
-    if(m_activeCamerasCount >= 3)
+    //one marker gives point on every edge it is seen from
+    if(m_cameraTopology.size() > 1)
+    {
+        weldPoints(triangulated);
+    }
+
+    m_pointWeights.clear();
+}
+
+void Room::Intersections()
+{
+    Triangulate(points);
+
+    if(m_recordRays)
     {
-        weldPoints(points);
+        m_rayRecording.addFrame(results, points, m_fusion.m_multiView);
     }
 
     labeledPoints = checker.solvePointIDs(points);
-    m_openGLWindow->setFrame(labeledPoints, results);
+}
+
+SyntheticStats Room::Benchmark(SyntheticScene &scene, size_t frames, bool replay, bool images)
+{
+    applySettings();
+
+    SyntheticStats stats;
+    std::map<size_t, size_t> labelToMarker;
+    std::vector<vec2> centroids;
+    std::vector<vec3> groundTruth;
+
+    QElapsedTimer benchmarkTimer, intersectionsTimer;
+    qint64 intersectionsTime = 0, replayTime = 0;
+    size_t replayMismatches = 0, unsynchronized = 0;
+
+    m_rawPointCount = 0;
+    m_weldTime = 0;
+    m_culledPairs = 0;
 
-    QCoreApplication::processEvents();
+    std::vector<size_t> culledRays(m_cameras.size());
 
-    if(m_captureAnimation)
+    for(size_t i = 0; i < m_cameras.size(); i++)
     {
-        actualAnimation->AddFrame(Frame(timer.elapsed(),labeledPoints, results));
+        culledRays[i] = m_cameras[i]->culledRays();
     }
 
-    for(size_t i = 0; i < workers.size(); i++)
+    scene.restart();
+    benchmarkTimer.start();
+
+    for(size_t f = 0; f < frames; f++)
     {
-        haveResults[i] = false;
+        if(images)
+        {
+            //replay timestamps tell which frame of the scene every camera rendered
+            bool synchronized = true;
+
+            for(size_t i = 0; i < m_cameras.size(); i++)
+            {
+                //element copy, sharing would make camera detach its lines on next frame
+                copyLines(m_cameras[i]->RecordNextFrame(), results[i]);
+                synchronized = synchronized && m_cameras[i]->frameTimestamp() == m_cameras[0]->frameTimestamp();
+            }
+
+            if(!synchronized)
+            {
+                ++unsynchronized;
+                continue;
+            }
+
+            groundTruth = scene.groundTruth((m_cameras[0]->frameTimestamp() - ReplayFrameSource::replayStart()) / 1e6);
+        }
+        else
+        {
+            SyntheticFrame frame = scene.nextFrame();
+
+            for(size_t i = 0; i < m_cameras.size() && i < frame.m_observations.size(); i++)
+            {
+                centroids.clear();
+
+                for(size_t j = 0; j < frame.m_observations[i].size(); j++)
+                {
+                    centroids.push_back(frame.m_observations[i][j].m_centroid);
+                }
+
+                results[i] = m_cameras[i]->LinesFromCentroids(centroids);
+            }
+
+            groundTruth.swap(frame.m_groundTruth);
+        }
+
+        setEdgeRays();
+
+        points.clear();
+
+        intersectionsTimer.start();
+        Intersections();
+        intersectionsTime += intersectionsTimer.nsecsElapsed();
+
+        if(replay)
+        {
+            //same rays again, points have to be bitwise equal and in the same order
+            size_t rawPointCount = m_rawPointCount, culledPairs = m_culledPairs;
+            qint64 weldTime = m_weldTime;
+
+            intersectionsTimer.start();
+
+            m_replayPoints.clear();
+            setEdgeRays();
+            Triangulate(m_replayPoints);
+
+            if(m_replayPoints.size() != points.size() || !std::equal(points.begin(), points.end(), m_replayPoints.begin()))
+            {
+                ++replayMismatches;
+            }
+
+            replayTime += intersectionsTimer.nsecsElapsed();
+
+            m_rawPointCount = rawPointCount;
+            m_culledPairs = culledPairs;
+            m_weldTime = weldTime;
+        }
+
+        SyntheticScene::evaluate(points, groundTruth, m_maxError, stats);
+
+        //labels of PointChecker should stay on the same marker
+        for(size_t i = 0; i < labeledPoints.size(); i++)
+        {
+            float minDistance = m_maxError;
+            int marker = -1;
+
+            for(size_t j = 0; j < groundTruth.size(); j++)
+            {
+                float distance = glm::distance(labeledPoints[i].m_position, groundTruth[j]);
+
+                if(distance < minDistance)
+                {
+                    minDistance = distance;
+                    marker = j;
+                }
+            }
+
+            if(marker == -1)
+            {
+                continue;
+            }
+
+            auto it = labelToMarker.find(labeledPoints[i].m_id);
+
+            if(it != labelToMarker.end() && it->second != (size_t) marker)
+            {
+                ++stats.m_idSwitches;
+            }
+
+            labelToMarker[labeledPoints[i].m_id] = marker;
+        }
     }
+
+    double seconds = (benchmarkTimer.nsecsElapsed() - replayTime) / 1e9;
+
+    std::cout << "synthetic benchmark, " << scene.cameraCount() << " cameras, " << scene.markerCount() << " markers: "
+              << frames / seconds << " fps, " << intersectionsTime / 1e6 / frames << " ms per frame in Intersections ("
+              << intersectRaysKernel() << " ray kernel)" << std::endl;
+
+    if(m_rawPointCount > 0)
+    {
+        std::cout << "welding " << (double) m_rawPointCount / frames << " raw points per frame: " << m_weldTime / 1e6 / frames << " ms per frame" << std::endl;
+    }
+
+    size_t culledRayCount = 0;
+
+    for(size_t i = 0; i < m_cameras.size(); i++)
+    {
+        culledRayCount += m_cameras[i]->culledRays() - culledRays[i];
+    }
+
+    std::cout << "culling: " << (double) culledRayCount / frames << " rays outside room, " << (double) m_culledPairs / frames
+              << " pairs meeting outside room per frame" << std::endl;
+
+    if(images)
+    {
+        std::cout << "image pipeline paced at " << scene.settings().m_fps << " fps, " << unsynchronized << " of " << frames
+                  << " frames skipped because cameras delivered different scene frames" << std::endl;
+
+        for(size_t i = 0; i < m_cameras.size(); i++)
+        {
+            std::cout << m_cameras[i]->getName().toStdString() << " grabbed: " << m_cameras[i]->grabbedFrames() << " processed: "
+                      << m_cameras[i]->processedFrames() << " dropped: " << m_cameras[i]->droppedFrames();
+
+            if(AllocationCounter::enabled())
+            {
+                std::cout << ", " << m_cameras[i]->steadyAllocations() << " heap allocations in "
+                          << m_cameras[i]->allocatingFrames() << " frames after warm-up";
+            }
+
+            std::cout << std::endl;
+        }
+    }
+
+    if(replay)
+    {
+        std::cout << "replay: " << replayMismatches << " of " << frames << " frames differ" << std::endl;
+    }
+
+    std::cout << stats << std::endl;
+
+    return stats;
+}
+
+void Room::startRayRecording()
+{
+    m_rayRecording.clear();
+    m_recordRays = true;
+}
+
+bool Room::saveRayRecording(const QString &fileName)
+{
+    m_recordRays = false;
+
+    bool saved = m_rayRecording.save(fileName);
+
+    std::cout << (saved ? "rays of " : "cannot save rays of ") << m_rayRecording.size() << " frames "
+              << (saved ? "saved to " : "to ") << fileName.toStdString() << std::endl;
+
+    m_rayRecording.clear();
+
+    return saved;
+}
+
+size_t Room::ReplayRays(const RayRecording &recording, int runs)
+{
+    applySettings();
+
+    size_t runMismatches = 0, recordedMismatches = 0, comparedFrames = 0, wrongFrames = 0;
+
+    //pairwise points depend on rounding of ray kernel, multi-view ones do not use it
+    bool sameKernel = recording.kernel() == intersectRaysKernel();
+
+    for(size_t f = 0; f < recording.size(); f++)
+    {
+        const RayFrame &frame = recording.frame(f);
+
+        if(frame.m_lines.size() != results.size())
+        {
+            ++wrongFrames;
+            continue;
+        }
+
+        results = frame.m_lines;
+
+        bool differs = false;
+
+        for(int run = 0; run < runs; run++)
+        {
+            std::vector<vec3> &triangulated = run == 0 ? points : m_replayPoints;
+
+            triangulated.clear();
+            setEdgeRays();
+            Triangulate(triangulated);
+
+            if(run > 0 && (m_replayPoints.size() != points.size() || !std::equal(points.begin(), points.end(), m_replayPoints.begin())))
+            {
+                differs = true;
+            }
+        }
+
+        runMismatches += differs;
+
+        //points of other triangulation mode or other kernel are not expected bitwise
+        if(frame.m_multiView != m_fusion.m_multiView || (!m_fusion.m_multiView && !sameKernel))
+        {
+            continue;
+        }
+
+        ++comparedFrames;
+
+        if(frame.m_points.size() != points.size() || !std::equal(points.begin(), points.end(), frame.m_points.begin()))
+        {
+            ++recordedMismatches;
+        }
+    }
+
+    std::cout << "replay of " << recording.size() << " recorded frames, " << runs << " runs each (" << intersectRaysKernel()
+              << " ray kernel, recorded with " << recording.kernel().toStdString() << "): " << runMismatches
+              << " frames differ between runs, " << recordedMismatches << " of " << comparedFrames
+              << " frames in the same triangulation mode differ from recording, " << wrongFrames
+              << " frames with other number of cameras than project" << std::endl;
+
+    return runMismatches + recordedMismatches + wrongFrames;
 }
 
 void Room::weldPoints(std::vector<glm::vec3> &points)
 {
+    QElapsedTimer timer;
+    timer.start();
 
+    m_rawPointCount += points.size();
+
+    m_welder.weld(points, m_pointWeights, m_fusion.m_maxError);
+
+    m_weldTime += timer.nsecsElapsed();
 }
 
 void Room::record2D()
@@ -522,6 +1120,7 @@ void Room::record2D()
     while(m_record)
     {
         points2D = m_cameras[m_lastActiveCamIndex]->RecordNextFrame2D();
+        updateFrameTime(m_cameras[m_lastActiveCamIndex]->frameTimestamp());
 
 
         labeledPoints = checker.solvePointIDs(points2D);
@@ -536,10 +1135,8 @@ void Room::record2D()
 
         if(m_captureAnimation)
         {
-            actualAnimation->AddFrame({timer.elapsed(),labeledPoints});
+            actualAnimation->AddFrame({m_frameElapsed,labeledPoints});
         }
-
-        timer.restart();
     }
 }
 
@@ -557,6 +1154,13 @@ const QString dimYKey("dimY");
 const QString dimZKey("dimZ");
 const QString errorKey("maxError");
 const QString camerasKey("cameras");
+const QString syncWindowKey("syncWindow");
+const QString syncLatencyKey("syncLatency");
+const QString epipolarToleranceKey("epipolarTolerance");
+const QString multiViewKey("multiView");
+const QString minCamerasKey("minCameras");
+const QString topologyPairsKey("topologyPairs");
+const QString rayRecordingKey("rayRecording");
 
 
 QVariantMap Room::toVariantMap()
@@ -568,6 +1172,17 @@ QVariantMap Room::toVariantMap()
     retVal[dimYKey] = m_roomDimensions.y;
     retVal[dimZKey] = m_roomDimensions.z;
     retVal[errorKey] = m_maxError;
+    retVal[syncWindowKey] = m_assembler.window() / 1000.0;
+    retVal[syncLatencyKey] = m_assembler.maxLatency() / 1000.0;
+    retVal[epipolarToleranceKey] = m_epipolarTolerance;
+    retVal[multiViewKey] = m_multiView;
+    retVal[minCamerasKey] = (int) m_triangulator.minCameras();
+    retVal[topologyPairsKey] = m_topologyPairs;
+
+    if(!m_rayRecordingFile.isEmpty())
+    {
+        retVal[rayRecordingKey] = m_rayRecordingFile;
+    }
 
     QVariantList list;
 
@@ -595,6 +1210,16 @@ void Room::fromVariantMap(OpenGLWindow *opengl , QVariantMap &varMap)
     std::cout << m_roomDimensions << std::endl;
 
     m_maxError  = varMap[errorKey].toDouble();
+    m_epipolarTolerance = varMap.value(epipolarToleranceKey, 2.0).toFloat();
+    m_multiView = varMap.value(multiViewKey, false).toBool();
+    m_triangulator.setMinCameras(varMap.value(minCamerasKey, 2).toInt());
+    m_topologyPairs = varMap.value(topologyPairsKey, 2).toInt();
+    m_rayRecordingFile = varMap.value(rayRecordingKey).toString();
+
+    //milliseconds in project file
+    m_assembler.setWindow(varMap.value(syncWindowKey, 16.0).toDouble() * 1000);
+    m_assembler.setMaxLatency(varMap.value(syncLatencyKey, 50.0).toDouble() * 1000);
+
     m_activeCamerasCount = 0;
     m_lastActiveCamIndex = 0;
 
@@ -611,64 +1236,7 @@ void Room::fromVariantMap(OpenGLWindow *opengl , QVariantMap &varMap)
 
         AddCamera(cam);
     }
-}
 
-/*
-void Edge::setFundamentalMatrix(glm::vec3 camPos1, glm::vec3 camRot1, cv::Mat intrinsicMatrix1, glm::vec3 camPos2, glm::vec3 camRot2, cv::Mat intrinsicMatrix2)
-{
-    camRot1 = glm::normalize(camRot1);
-    camRot2 = glm::normalize(camRot2);
-
-    vec3 v = glm::cross(camRot1, camRot2);
-
-    float s = glm::length(v);
-
-    float c = glm::dot(camRot1, camRot2);
-
-    cv::Mat diag = cv::Mat::eye(3,3, CV_32F);
-
-    cv::Mat vx = cv::Mat::zeros(3,3, CV_32F);
-
-    vx.at<float>(0,1) = - v.z;
-    vx.at<float>(1,0) = v.z;
-
-    vx.at<float>(0,2) = v.y;
-    vx.at<float>(2,0) = -v.y;
-
-    vx.at<float>(1,2) = -v.x;
-    vx.at<float>(2,1) = v.x;
-
-    std::cout << "vx" << std::endl << vx << std::endl;
-
-    cv::Mat rotMatrix =  diag + vx + vx*vx*((1-c)/s*s);
-
-    std::cout << "rotation matrix" << std::endl << rotMatrix << std::endl;
-
-    vec3 t = camPos2 - camPos1;
-
-    cv::Mat tx = cv::Mat::zeros(3,3, CV_32F);
-
-    tx.at<float>(0,1) = -t.z;
-    tx.at<float>(1,0) = t.z;
-
-    tx.at<float>(0,2) = t.y;
-    tx.at<float>(2,0) = -t.y;
-
-    tx.at<float>(1,2) = -t.x;
-    tx.at<float>(2,1) = t.x;
-
-    cv::Mat essentialMatrix = rotMatrix * tx;
-    std::cout << "essential matrix" << std::endl << essentialMatrix << std::endl;
-
-    this->m_fundamentalMatrix = intrinsicMatrix2.t().inv(DECOMP_SVD) * essentialMatrix * intrinsicMatrix1.inv(DECOMP_SVD);
-
-    cv::Mat point = cv::Mat::ones(3,1, CV_32F);
-    point.at<float>(0,0) = 331;
-    point.at<float>(1,0) = 301;
-
-    std::cout << "point mul" << point.t() * m_fundamentalMatrix * point << std::endl;
-
-
-    std::cout << "fundamentalMatrix" << std::endl << m_fundamentalMatrix << std::endl;
+    //project without cameras has to reach fusion too
+    updateFusionSettings(true);
 }
-*/
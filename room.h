@@ -26,8 +26,18 @@
 #include "animation.h"
 #include "pointchecker.h"
 #include "capturethread.h"
-
-#include <QTime>
+#include "syntheticscene.h"
+#include "frameassembler.h"
+#include "triangulator.h"
+#include "pointwelder.h"
+#include "raybatch.h"
+#include "cameratopology.h"
+#include "fusionthread.h"
+#include "rayrecording.h"
+#include <QFuture>
+#include <QMutex>
+#include <QThreadPool>
+#include <QTimer>
 #include <QtNetwork/QLocalServer>
 #include <QtNetwork/QLocalSocket>
 
@@ -40,7 +50,34 @@ public:
     size_t m_index1, m_index2;
     QVector<Line> a ,b;
     float m_maxError;
-    QVector <glm::vec3> points;
+    EpipolarGeometry m_epipolar;
+    std::vector<std::pair<float, int>> m_sortedB;
+    RayBatch m_batchB;              /// rays of b in epipolar order, band is continuous range
+    std::vector<RayHit> m_hits;     /// output of the edge, written only by its own task
+    size_t m_culledPairs = 0;       /// pairs of last frame meeting outside of the room
+};
+
+/// configuration fusion works with, GUI thread changes Room and fusion thread copies it between frames
+class FusionSettings
+{
+public:
+    glm::vec3 m_roomDimensions;
+    double m_maxError = 0;
+    float m_epipolarTolerance = 2.0f;
+    int m_topologyPairs = 2;
+    bool m_multiView = false;
+    size_t m_numberOfPoints = 1;
+};
+
+/// triangulated frame waiting for GUI, pipe and animation
+class FusedFrame
+{
+public:
+    int m_elapsed;
+    std::vector<glm::vec3> m_points;
+    std::vector<Point> m_labeledPoints;
+    QVector<QVector<Line>> m_lines;
+    std::vector<TriangulatedPoint> m_triangulatedPoints;    /// residuals of points, multi-view only
 };
 
 class Room : public QObject
@@ -51,10 +88,14 @@ class Room : public QObject
     QString m_name;
     glm::vec3 m_roomDimensions; //centimeters
     double m_maxError;
+    float m_epipolarTolerance = 2.0f;   //degrees
+    int m_topologyPairs = 2;            //best pairs of every camera, 0 for all overlapping pairs
     bool m_saved;
     OpenGLWindow *m_openGLWindow = nullptr;
 
     std::vector <Edge> m_cameraTopology;
+    QThreadPool m_intersectionPool;     //persistent threads, one per core
+    std::vector<QFuture<void>> m_intersectionFutures;
     std::vector <CaptureCamera*> m_cameras;
 
     size_t m_activeCamerasCount;
@@ -70,22 +111,59 @@ class Room : public QObject
     QLocalServer *server = nullptr;
     QLocalSocket *socket = nullptr;
 
-    //parallel
-    QWaitCondition allLines;
-
     //cams
-    std::vector <bool> haveResults;
     QVector<QVector<Line>> results;
 
     std::vector <worker*> workers;
     std::vector <QThread*> workerthreads;
 
-    //intersections
-    QTime timer;
+    //one ring per camera worker, drained by fusion thread
+    std::vector <ObservationQueue*> m_observationQueues;
+    FusionThread *m_fusionThread;
+    MultiViewFrame m_fusionFrame;
+
+    //setters and fusion hold the mutex only to write or copy settings, never during a frame
+    QMutex m_settingsMutex;
+    bool m_settingsChanged = false;
+    bool m_topologyChanged = false;
+    FusionSettings m_fusion;            //copy used by fusion, Benchmark and ReplayRays
+
+    //finished frames, GUI timer takes them, slots circulate between both rings with their storage
+    static const size_t finishedSlots = 120;
+    QMutex m_finishedMutex;
+    std::vector<FusedFrame> m_finishedFrames;
+    size_t m_finishedFirst = 0;
+    size_t m_finishedCount = 0;
+    std::vector<FusedFrame> m_shownFrames;
+    size_t m_unshownFrames = 0;         //dropped because GUI did not keep up
+    std::vector<TriangulatedPoint> m_shownTriangulatedPoints;  //of newest shown frame, GUI thread only
+    QTimer m_frameTimer;
+
+    //multi camera sync
+    FrameAssembler m_assembler;
+    qint64 m_lastFrameTimestamp = 0;
+    int m_frameElapsed = 0;
+    size_t m_truncatedObservations = 0; //camera saw more blobs than maxBlobs, written by fusion thread
+    size_t m_truncatedLines = 0;
 
     std::vector<glm::vec3> points;
+    std::vector<float> m_pointWeights;
+    PointWelder m_welder;
+    size_t m_rawPointCount = 0;     //statistics for Benchmark
+    qint64 m_weldTime = 0;
+    size_t m_culledPairs = 0;
+    std::vector<glm::vec3> m_replayPoints;  //second run of the same frame in Benchmark
+    QString m_rayRecordingFile;     //rays of every recording are saved there when set in project
+    bool m_recordRays = false;
+    RayRecording m_rayRecording;
     std::vector<glm::vec2> points2D; //2Drecording
 
+    //multi-view triangulation replaces pairwise edges
+    bool m_multiView = false;
+    size_t m_numberOfPoints = 1;
+    Triangulator m_triangulator;
+    std::vector<TriangulatedPoint> m_triangulatedPoints;    //written by Triangulate, GUI gets copy in FusedFrame
+
     PointChecker checker;
     std::vector<Point> labeledPoints;
 
@@ -101,6 +179,7 @@ public:
     void RemoveCamera(size_t index);
     //void Save(std::ofstream &file);
 
+    /// builds edges from settings of fusion, only while fusion thread is stopped or from it
     void MakeTopology();
     void resolveTopologyDuplicates();
 
@@ -118,6 +197,8 @@ public:
     void setDimensions(glm::vec3 dims);
     void setName(QString name){this->m_name = name;}
     void setEpsilon(float size);
+    void setEpipolarTolerance(float degrees);
+    void setMultiView(bool multiView);
     void setNumberOfPoints(size_t nOfPts);
 
     QString getName() const {return m_name;}
@@ -125,6 +206,12 @@ public:
     int getWidth()const {return m_roomDimensions.x;}
     int getLength()const {return m_roomDimensions.y;}
     float getEpsilon() const {return m_maxError;}
+    float getEpipolarTolerance() const {return m_epipolarTolerance;}
+    void setTopologyPairs(int pairs);
+    int getTopologyPairs() const {return m_topologyPairs;}
+    bool getMultiView() const {return m_multiView;}
+    /// points of newest shown frame with residual and number of cameras, multi-view only, GUI thread
+    const std::vector<TriangulatedPoint> &getTriangulatedPoints() const {return m_shownTriangulatedPoints;}
     bool getSaved() const {return m_saved;}
     QVector<QVector<Line>> getLines() const {return results;}
     std::vector <CaptureCamera*> getcameras()const {return m_cameras;}
@@ -133,13 +220,25 @@ public:
 
     static void Intersection(Edge &camsEdge);
 
+    /// replay runs triangulation of every frame twice and reports frames with different points,
+    /// images takes lines from turned on cameras reading SyntheticFrameSource instead of projected centroids
+    SyntheticStats Benchmark(SyntheticScene &scene, size_t frames, bool replay = false, bool images = false);
+
+    /// every triangulated frame is kept with its rays until saveRayRecording
+    void startRayRecording();
+    bool saveRayRecording(const QString &fileName);
+    /// triangulates every recorded frame runs times, returns number of frames whose points differ
+    /// between runs or from the recorded ones, when they come from the same mode and ray kernel,
+    /// recording must be stopped
+    size_t ReplayRays(const RayRecording &recording, int runs);
+
 signals:
     void startWork();
     void stopWork();
     void startWork2D();
 
 private slots:
-    void ResultReady(QVector<Line> lines);
+    void showFrames();
     void record2D();
     void handleConnection();
 
@@ -148,7 +247,15 @@ private:
     void sendMessage(std::vector<glm::vec2> points);
     void sendMessage(std::string str);
 
+    void updateFusionSettings(bool topology);
+    void applySettings();
+    void setEdgeSettings();
+
+    bool fuseObservations();
     void Intersections();
+    void Triangulate(std::vector<glm::vec3> &triangulated);
+    void setEdgeRays();
+    void updateFrameTime(qint64 timestamp);
 
     void weldPoints(std::vector<glm::vec3> &points);
 
@@ -0,0 +1,143 @@
+/*
+ *
+ * Copyright (C) 2014  Miroslav Krajicek, Faculty of Informatics Masaryk University (https://github.com/kaajo).
+ * All Rights Reserved.
+ *
+ * This file is part of WebCamCap.
+ *
+ * WebCamCap is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU LGPL version 3 as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WebCamCap is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU LGPL version 3
+ * along with WebCamCap. If not, see <http://www.gnu.org/licenses/lgpl-3.0.txt>.
+ *
+ */
+
+#include "runlengthdetector.h"
+#include "thresholdkernel.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+RunLengthDetector::RunLengthDetector(int minArea, int maxArea)
+{
+    m_minArea = minArea;
+    m_maxArea = maxArea;
+}
+
+size_t RunLengthDetector::capacity() const
+{
+    return (m_previous.capacity() + m_current.capacity()) * sizeof(Run) + m_labels.capacity();
+}
+
+void RunLengthDetector::addRun(int start, int end, int y, long long weight, long long weightedSumX)
+{
+    int label = 0;
+
+    //runs of previous row are sorted, runs ending left of this one cannot touch next runs either
+    while(m_cursor < m_previous.size() && m_previous[m_cursor].m_end + 1 < start)
+    {
+        ++m_cursor;
+    }
+
+    for(size_t i = m_cursor; i < m_previous.size() && m_previous[i].m_start <= end + 1; i++)
+    {
+        if(m_previous[i].m_end + 1 >= start)
+        {
+            label = label ? m_labels.unite(label, m_previous[i].m_label) : m_previous[i].m_label;
+        }
+    }
+
+    if(!label)
+    {
+        label = m_labels.newLabel(start, y);
+    }
+
+    m_labels.addRun(label, start, end, y);
+    m_labels.addWeight(label, weight, weightedSumX, y);
+
+    m_current.push_back({start, end, label});
+}
+
+template<bool background>
+void RunLengthDetector::scan(const cv::Mat &frame, const cv::Mat &reference, int diffThreshold, int threshold)
+{
+    for(int y = 0; y < frame.rows; y++)
+    {
+        const uchar *row = frame.ptr<uchar>(y);
+        const uchar *referenceRow = background ? reference.ptr<uchar>(y) : nullptr;
+
+        m_current.clear();
+        m_cursor = 0;
+
+        int start = -1;
+        long long weight = 0, weightedSumX = 0;
+
+        for(int x = 0; x < frame.cols; x++)
+        {
+            const uchar *pixel = row + 3*x;
+            int gray = grayLevel(pixel);
+
+            bool foreground = gray > threshold;
+
+            if(background && foreground)
+            {
+                const uchar *ref = referenceRow + 3*x;
+                const uchar diff[3] = {(uchar) std::abs(pixel[0] - ref[0]), (uchar) std::abs(pixel[1] - ref[1]), (uchar) std::abs(pixel[2] - ref[2])};
+
+                foreground = grayLevel(diff) > diffThreshold;
+            }
+
+            if(foreground)
+            {
+                if(start == -1)
+                {
+                    start = x;
+                    weight = weightedSumX = 0;
+                }
+
+                weight += gray - threshold;
+                weightedSumX += (long long) (gray - threshold) * x;
+            }
+            else if(start != -1)
+            {
+                addRun(start, x - 1, y, weight, weightedSumX);
+                start = -1;
+            }
+        }
+
+        if(start != -1)
+        {
+            addRun(start, frame.cols - 1, y, weight, weightedSumX);
+        }
+
+        std::swap(m_previous, m_current);
+    }
+}
+
+void RunLengthDetector::detect(const cv::Mat &frame, const cv::Mat &background, cv::Point offset, std::vector<Blob> &blobs, int threshold, int diffThreshold)
+{
+    CV_Assert(frame.type() == CV_8UC3);
+    CV_Assert(background.empty() || (background.type() == CV_8UC3 && background.size() == frame.size()));
+
+    m_previous.clear();
+    m_labels.clear();
+
+    if(background.empty())
+    {
+        scan<false>(frame, background, diffThreshold, threshold);
+    }
+    else
+    {
+        scan<true>(frame, background, diffThreshold, threshold);
+    }
+
+    m_labels.blobs(m_minArea, m_maxArea, offset, blobs);
+}
@@ -0,0 +1,71 @@
+/*
+ *
+ * Copyright (C) 2014  Miroslav Krajicek, Faculty of Informatics Masaryk University (https://github.com/kaajo).
+ * All Rights Reserved.
+ *
+ * This file is part of WebCamCap.
+ *
+ * WebCamCap is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU LGPL version 3 as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WebCamCap is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU LGPL version 3
+ * along with WebCamCap. If not, see <http://www.gnu.org/licenses/lgpl-3.0.txt>.
+ *
+ */
+
+#ifndef RUNLENGTHDETECTOR_H
+#define RUNLENGTHDETECTOR_H
+
+#include "blobextractor.h"
+
+/**
+ * @brief blob detector for bright markers, thresholds frame row by row into runs, no mask is built
+ *
+ * Runs touching runs of previous row (8-connectivity) are joined by union-find, so the frame is read once.
+ * There is no median or morphology, small noise is removed by minimal area.
+ */
+class RunLengthDetector
+{
+    class Run
+    {
+    public:
+        int m_start;
+        int m_end;
+        int m_label;
+    };
+
+    std::vector<Run> m_previous;
+    std::vector<Run> m_current;
+    size_t m_cursor = 0;
+    ComponentLabels m_labels;
+
+    int m_minArea;
+    int m_maxArea;
+
+    template<bool background>
+    void scan(const cv::Mat &frame, const cv::Mat &reference, int diffThreshold, int threshold);
+    void addRun(int start, int end, int y, long long weight, long long weightedSumX);
+
+public:
+    RunLengthDetector(int minArea = 10, int maxArea = 500);
+
+    void setAreaLimits(int minArea, int maxArea) {m_minArea = minArea; m_maxArea = maxArea;}
+
+    /// bytes reserved by internal buffers
+    size_t capacity() const;
+
+    /**
+     * @brief appends blobs of pixels with gray level above threshold, offset is added to coordinates
+     * @param background optional reference frame, pixel has to differ from it by more than diffThreshold in gray
+     */
+    void detect(const cv::Mat &frame, const cv::Mat &background, cv::Point offset, std::vector<Blob> &blobs, int threshold, int diffThreshold = 20);
+};
+
+#endif // RUNLENGTHDETECTOR_H
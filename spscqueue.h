@@ -0,0 +1,135 @@
+/*
+ *
+ * Copyright (C) 2014  Miroslav Krajicek, Faculty of Informatics Masaryk University (https://github.com/kaajo).
+ * All Rights Reserved.
+ *
+ * This file is part of WebCamCap.
+ *
+ * WebCamCap is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU LGPL version 3 as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WebCamCap is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU LGPL version 3
+ * along with WebCamCap. If not, see <http://www.gnu.org/licenses/lgpl-3.0.txt>.
+ *
+ */
+
+#ifndef SPSCQUEUE_H
+#define SPSCQUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+/**
+ * @brief lock-free ring for one producer and one consumer thread
+ *
+ * Records are preallocated and written in place, producer fills slot between beginPush and commitPush,
+ * consumer reads front until pop. Full ring rejects new records, the newest ones are lost, not the oldest.
+ * Each side reads index of the other one once per call.
+ */
+template<typename T>
+class SpscQueue
+{
+    std::vector<T> m_slots;
+    size_t m_mask;
+
+    //padding keeps indices of both threads on different cache lines, heap gives no 64 byte alignment before C++17
+    char m_padding0[64];
+    std::atomic<size_t> m_head;     /// next slot to read, written by consumer
+    char m_padding1[64];
+    std::atomic<size_t> m_tail;     /// next slot to write, written by producer
+    std::atomic<size_t> m_rejected;
+    char m_padding2[64];
+
+public:
+    /// capacity is rounded up to power of two
+    explicit SpscQueue(size_t capacity = 16);
+
+    /// producer, free slot or nullptr if ring is full
+    T *beginPush();
+    void commitPush();
+
+    /// consumer, oldest record or nullptr if ring is empty
+    T *front();
+    void pop();
+
+    /// setup of records, only while neither thread uses the ring
+    template<typename Function>
+    void forEachSlot(Function function);
+
+    size_t capacity() const {return m_slots.size();}
+    size_t rejected() const {return m_rejected;}
+};
+
+template<typename T>
+SpscQueue<T>::SpscQueue(size_t capacity) :
+    m_head(0), m_tail(0), m_rejected(0)
+{
+    size_t size = 2;
+
+    while(size < capacity)
+    {
+        size *= 2;
+    }
+
+    m_slots.resize(size);
+    m_mask = size - 1;
+}
+
+template<typename T>
+template<typename Function>
+void SpscQueue<T>::forEachSlot(Function function)
+{
+    for(T &slot: m_slots)
+    {
+        function(slot);
+    }
+}
+
+template<typename T>
+T *SpscQueue<T>::beginPush()
+{
+    size_t tail = m_tail.load(std::memory_order_relaxed);
+
+    if(tail - m_head.load(std::memory_order_acquire) == m_slots.size())
+    {
+        m_rejected.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    return &m_slots[tail & m_mask];
+}
+
+template<typename T>
+void SpscQueue<T>::commitPush()
+{
+    m_tail.store(m_tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+template<typename T>
+T *SpscQueue<T>::front()
+{
+    size_t head = m_head.load(std::memory_order_relaxed);
+
+    if(head == m_tail.load(std::memory_order_acquire))
+    {
+        return nullptr;
+    }
+
+    return &m_slots[head & m_mask];
+}
+
+template<typename T>
+void SpscQueue<T>::pop()
+{
+    m_head.store(m_head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+#endif // SPSCQUEUE_H
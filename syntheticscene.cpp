@@ -0,0 +1,264 @@
+/*
+ *
+ * Copyright (C) 2014  Miroslav Krajicek, Faculty of Informatics Masaryk University (https://github.com/kaajo).
+ * All Rights Reserved.
+ *
+ * This file is part of WebCamCap.
+ *
+ * WebCamCap is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU LGPL version 3 as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WebCamCap is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU LGPL version 3
+ * along with WebCamCap. If not, see <http://www.gnu.org/licenses/lgpl-3.0.txt>.
+ *
+ */
+
+#include "syntheticscene.h"
+
+#include <cstdint>
+
+using glm::vec2;
+using glm::vec3;
+using namespace cv;
+
+vec3 MarkerTrajectory::positionAt(double time) const
+{
+    if(m_keyPositions.empty())
+    {
+        return vec3(0,0,0);
+    }
+
+    if(m_keyPositions.size() == 1 || m_keyPeriod <= 0)
+    {
+        return m_keyPositions[0];
+    }
+
+    double keyTime = time / m_keyPeriod;
+    double keyIndex = floor(keyTime);
+
+    size_t index1 = (size_t) keyIndex % m_keyPositions.size();
+    size_t index2 = (index1 + 1) % m_keyPositions.size();
+
+    return glm::mix(m_keyPositions[index1], m_keyPositions[index2], (float) (keyTime - keyIndex));
+}
+
+std::ostream& operator << (std::ostream &stream, const SyntheticStats &stats)
+{
+    stream << "frames: " << stats.m_frames << " found: " << stats.m_truePositives << " missed: " << stats.m_missed
+           << " ghosts: " << stats.m_ghosts << " id switches: " << stats.m_idSwitches << " rms error: " << stats.rmsError();
+
+    return stream;
+}
+
+SyntheticScene::SyntheticScene(std::vector<CaptureCamera *> cameras, std::vector<MarkerTrajectory> markers, SyntheticSettings settings) :
+    m_rng(settings.m_seed)
+{
+    m_cameras = cameras;
+    m_markers = markers;
+    m_settings = settings;
+}
+
+std::vector<MarkerTrajectory> SyntheticScene::randomTrajectories(size_t count, vec3 roomDimensions, size_t keys, double keyPeriod, uint64 seed)
+{
+    RNG rng(seed);
+    std::vector<MarkerTrajectory> trajectories(count);
+
+    for(size_t i = 0; i < count; i++)
+    {
+        trajectories[i].m_keyPeriod = keyPeriod;
+        trajectories[i].m_keyPositions.reserve(keys);
+
+        for(size_t j = 0; j < keys; j++)
+        {
+            //keep markers away from walls, cameras are usually placed there
+            trajectories[i].m_keyPositions.push_back(vec3(rng.uniform(0.1f, 0.9f) * roomDimensions.x,
+                                                          rng.uniform(0.1f, 0.9f) * roomDimensions.y,
+                                                          rng.uniform(0.1f, 0.9f) * roomDimensions.z));
+        }
+    }
+
+    return trajectories;
+}
+
+std::vector<vec3> SyntheticScene::groundTruth(double time) const
+{
+    std::vector<vec3> positions;
+    positions.reserve(m_markers.size());
+
+    for(size_t i = 0; i < m_markers.size(); i++)
+    {
+        positions.push_back(m_markers[i].positionAt(time));
+    }
+
+    return positions;
+}
+
+std::vector<SyntheticObservation> SyntheticScene::observe(size_t camera, double time, RNG &rng) const
+{
+    std::vector<SyntheticObservation> observations;
+    CaptureCamera *cam = m_cameras[camera];
+    vec2 pixel;
+
+    for(size_t i = 0; i < m_markers.size(); i++)
+    {
+        if(m_settings.m_occlusion > 0 && rng.uniform(0.0f, 1.0f) < m_settings.m_occlusion)
+        {
+            continue;
+        }
+
+        if(!cam->ProjectPoint(m_markers[i].positionAt(time), pixel))
+        {
+            continue;
+        }
+
+        if(m_settings.m_noise > 0)
+        {
+            pixel += vec2(rng.gaussian(m_settings.m_noise), rng.gaussian(m_settings.m_noise));
+            pixel = glm::clamp(pixel, vec2(0,0), cam->m_resolution - vec2(1,1));
+        }
+
+        observations.push_back({i, pixel});
+    }
+
+    for(int i = 0; i < m_settings.m_clutter; i++)
+    {
+        observations.push_back({SIZE_MAX, vec2(rng.uniform(0.0f, cam->m_resolution.x), rng.uniform(0.0f, cam->m_resolution.y))});
+    }
+
+    return observations;
+}
+
+void SyntheticScene::render(size_t camera, const std::vector<SyntheticObservation> &observations, Mat &image) const
+{
+    const int shift = 4;
+    vec2 resolution = m_cameras[camera]->m_resolution;
+
+    image.create(resolution.y, resolution.x, CV_8UC3);
+    image.setTo(Scalar::all(0));
+
+    for(size_t i = 0; i < observations.size(); i++)
+    {
+        cv::Point center(cvRound(observations[i].m_centroid.x * (1 << shift)), cvRound(observations[i].m_centroid.y * (1 << shift)));
+
+        circle(image, center, cvRound(m_settings.m_blobRadius * (1 << shift)), Scalar::all(255), CV_FILLED, CV_AA, shift);
+    }
+}
+
+SyntheticFrame SyntheticScene::nextFrame()
+{
+    SyntheticFrame frame;
+
+    frame.m_time = m_frameIndex / m_settings.m_fps;
+    frame.m_groundTruth = groundTruth(frame.m_time);
+    frame.m_observations.resize(m_cameras.size());
+
+    for(size_t i = 0; i < m_cameras.size(); i++)
+    {
+        frame.m_observations[i] = observe(i, frame.m_time, m_rng);
+    }
+
+    ++m_frameIndex;
+
+    return frame;
+}
+
+void SyntheticScene::restart()
+{
+    m_frameIndex = 0;
+    m_rng = RNG(m_settings.m_seed);
+}
+
+void SyntheticScene::evaluate(const std::vector<vec3> &points, const std::vector<vec3> &groundTruth, float maxDistance, SyntheticStats &stats)
+{
+    std::vector<bool> used(points.size(), false);
+    size_t matched = 0;
+
+    for(size_t i = 0; i < groundTruth.size(); i++)
+    {
+        float minDistance = maxDistance;
+        int minIndex = -1;
+
+        for(size_t j = 0; j < points.size(); j++)
+        {
+            float distance = glm::distance(points[j], groundTruth[i]);
+
+            if(!used[j] && distance < minDistance)
+            {
+                minDistance = distance;
+                minIndex = j;
+            }
+        }
+
+        if(minIndex == -1)
+        {
+            ++stats.m_missed;
+        }
+        else
+        {
+            used[minIndex] = true;
+            ++matched;
+            stats.m_squaredErrorSum += minDistance * minDistance;
+        }
+    }
+
+    stats.m_truePositives += matched;
+    stats.m_ghosts += points.size() - matched;
+    ++stats.m_frames;
+}
+
+SyntheticFrameSource::SyntheticFrameSource(const SyntheticScene *scene, size_t camera, ReplayMode mode) :
+    ReplayFrameSource("synthetic", mode, scene->settings().m_fps, true),
+    m_rng(scene->settings().m_seed + camera + 1)
+{
+    m_scene = scene;
+    m_camera = camera;
+}
+
+bool SyntheticFrameSource::open()
+{
+    m_frameIndex = 0;
+    m_opened = true;
+
+    restartPacing();
+
+    return true;
+}
+
+void SyntheticFrameSource::release()
+{
+    m_opened = false;
+}
+
+bool SyntheticFrameSource::read(Mat &frame)
+{
+    if(!m_opened)
+    {
+        return false;
+    }
+
+    double time = m_frameIndex++ / m_fps;
+
+    m_scene->render(m_camera, m_scene->observe(m_camera, time, m_rng), frame);
+
+    pace();
+    stampFrame();
+
+    return true;
+}
+
+QVariantMap SyntheticFrameSource::toVariantMap() const
+{
+    QVariantMap retVal;
+
+    //synthetic scenes are built in code, project keeps using the device
+    retVal["source"] = "device";
+
+    return retVal;
+}
@@ -0,0 +1,128 @@
+/*
+ *
+ * Copyright (C) 2014  Miroslav Krajicek, Faculty of Informatics Masaryk University (https://github.com/kaajo).
+ * All Rights Reserved.
+ *
+ * This file is part of WebCamCap.
+ *
+ * WebCamCap is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU LGPL version 3 as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WebCamCap is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU LGPL version 3
+ * along with WebCamCap. If not, see <http://www.gnu.org/licenses/lgpl-3.0.txt>.
+ *
+ */
+
+#ifndef SYNTHETICSCENE_H
+#define SYNTHETICSCENE_H
+
+#include "capturecamera.h"
+#include "framesource.h"
+
+/// marker path given by positions sampled every m_keyPeriod seconds, loops at the end
+class MarkerTrajectory
+{
+public:
+    std::vector<glm::vec3> m_keyPositions;
+    double m_keyPeriod = 1.0;
+
+    glm::vec3 positionAt(double time) const;
+};
+
+class SyntheticSettings
+{
+public:
+    double m_fps = 60.0;
+    float m_noise = 0.0f;      /// sigma of centroid noise in pixels
+    float m_occlusion = 0.0f;  /// probability that a marker is hidden from one camera
+    float m_blobRadius = 3.0f; /// radius of rendered marker in pixels
+    int m_clutter = 0;         /// bright spots at random pixels in every camera, reflections and lights
+    uint64 m_seed = 0;
+};
+
+class SyntheticObservation
+{
+public:
+    size_t m_markerId;         /// SIZE_MAX for clutter
+    glm::vec2 m_centroid;
+};
+
+class SyntheticFrame
+{
+public:
+    double m_time = 0;
+    std::vector<glm::vec3> m_groundTruth;
+    std::vector<std::vector<SyntheticObservation>> m_observations; /// per camera
+};
+
+class SyntheticStats
+{
+public:
+    size_t m_frames = 0;
+    size_t m_truePositives = 0;
+    size_t m_missed = 0;
+    size_t m_ghosts = 0;
+    size_t m_idSwitches = 0;
+    double m_squaredErrorSum = 0;
+
+    double rmsError() const {return m_truePositives ? sqrt(m_squaredErrorSum / m_truePositives) : 0;}
+};
+
+std::ostream& operator << (std::ostream &stream, const SyntheticStats &stats);
+
+class SyntheticScene
+{
+    std::vector<CaptureCamera*> m_cameras;
+    std::vector<MarkerTrajectory> m_markers;
+    SyntheticSettings m_settings;
+
+    cv::RNG m_rng;
+    size_t m_frameIndex = 0;
+
+public:
+    SyntheticScene(std::vector<CaptureCamera*> cameras, std::vector<MarkerTrajectory> markers, SyntheticSettings settings = SyntheticSettings());
+
+    static std::vector<MarkerTrajectory> randomTrajectories(size_t count, glm::vec3 roomDimensions, size_t keys = 20, double keyPeriod = 0.5, uint64 seed = 0);
+
+    size_t cameraCount() const {return m_cameras.size();}
+    size_t markerCount() const {return m_markers.size();}
+    const SyntheticSettings &settings() const {return m_settings;}
+
+    std::vector<glm::vec3> groundTruth(double time) const;
+    std::vector<SyntheticObservation> observe(size_t camera, double time, cv::RNG &rng) const;
+    void render(size_t camera, const std::vector<SyntheticObservation> &observations, cv::Mat &image) const;
+
+    SyntheticFrame nextFrame();
+    void restart();
+
+    static void evaluate(const std::vector<glm::vec3> &points, const std::vector<glm::vec3> &groundTruth, float maxDistance, SyntheticStats &stats);
+};
+
+/// renders frames of one camera of synthetic scene, so the full image pipeline can run without hardware
+class SyntheticFrameSource : public ReplayFrameSource
+{
+    const SyntheticScene *m_scene;
+    size_t m_camera;
+    size_t m_frameIndex = 0;
+    bool m_opened = false;
+    cv::RNG m_rng;
+
+public:
+    SyntheticFrameSource(const SyntheticScene *scene, size_t camera, ReplayMode mode = ReplayMode::REALTIME);
+
+    bool open();
+    void release();
+    bool isOpened() const {return m_opened;}
+    bool read(cv::Mat &frame);
+
+    QVariantMap toVariantMap() const;
+};
+
+#endif // SYNTHETICSCENE_H
@@ -0,0 +1,148 @@
+/*
+ *
+ * Copyright (C) 2014  Miroslav Krajicek, Faculty of Informatics Masaryk University (https://github.com/kaajo).
+ * All Rights Reserved.
+ *
+ * This file is part of WebCamCap.
+ *
+ * WebCamCap is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU LGPL version 3 as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WebCamCap is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU LGPL version 3
+ * along with WebCamCap. If not, see <http://www.gnu.org/licenses/lgpl-3.0.txt>.
+ *
+ */
+
+
+#include "room.h"
+#include "syntheticscene.h"
+#include "rayrecording.h"
+
+#include <QStandardPaths>
+#include <QTemporaryDir>
+#include <QtTest>
+
+/**
+ * @brief rays of a synthetic scene are recorded, saved and triangulated again
+ *
+ * Every replayed frame is triangulated several times, points have to be bitwise equal between runs
+ * and to the recorded ones. Scene is generated from fixed seed, so no recording has to be committed.
+ */
+class RayReplayTest : public QObject
+{
+    Q_OBJECT
+
+    static const size_t frames = 120;
+    static const size_t markers = 12;
+    static const int runs = 4;
+
+    QTemporaryDir m_directory;
+    Room *m_room = nullptr;
+
+    bool record(bool multiView, const QString &fileName);
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void pairwiseReplayIsIdentical();
+    void multiViewReplayIsIdentical();
+    void otherModeIsNotCompared();
+};
+
+const size_t RayReplayTest::frames;
+const size_t RayReplayTest::markers;
+const int RayReplayTest::runs;
+
+bool RayReplayTest::record(bool multiView, const QString &fileName)
+{
+    m_room->setMultiView(multiView);
+
+    SyntheticSettings settings;
+    settings.m_noise = 0.5f;
+    settings.m_occlusion = 0.1f;
+    settings.m_clutter = 2;
+    settings.m_seed = 7;
+
+    SyntheticScene scene(m_room->getcameras(), SyntheticScene::randomTrajectories(markers, m_room->getDimensions(), 20, 0.5, settings.m_seed), settings);
+
+    m_room->startRayRecording();
+    m_room->Benchmark(scene, frames);
+
+    return m_room->saveRayRecording(fileName);
+}
+
+void RayReplayTest::initTestCase()
+{
+    //camera cache of the test does not mix with the one of the application
+    QStandardPaths::setTestModeEnabled(true);
+
+    QVERIFY(m_directory.isValid());
+
+    glm::vec3 dimensions(400, 400, 250);
+    m_room = new Room(nullptr, dimensions, 1.0f, "Ray replay");
+
+    const glm::vec3 positions[] = {glm::vec3(0, 0, 250), glm::vec3(400, 0, 250), glm::vec3(400, 400, 250), glm::vec3(0, 400, 250)};
+
+    for(size_t i = 0; i < 4; i++)
+    {
+        m_room->AddCamera(new CaptureCamera(glm::vec2(640, 480), positions[i], dimensions, QString("camera %1").arg(i), i, 60.0f));
+    }
+
+    m_room->setNumberOfPoints(markers);
+}
+
+void RayReplayTest::cleanupTestCase()
+{
+    delete m_room;
+}
+
+void RayReplayTest::pairwiseReplayIsIdentical()
+{
+    QString fileName = m_directory.filePath("pairwise.rays");
+    QVERIFY(record(false, fileName));
+
+    RayRecording recording;
+    QVERIFY(recording.load(fileName));
+    QCOMPARE(recording.size(), frames);
+    QVERIFY(!recording.frame(0).m_points.empty());
+
+    QCOMPARE(m_room->ReplayRays(recording, runs), size_t(0));
+}
+
+void RayReplayTest::multiViewReplayIsIdentical()
+{
+    QString fileName = m_directory.filePath("multiview.rays");
+    QVERIFY(record(true, fileName));
+
+    RayRecording recording;
+    QVERIFY(recording.load(fileName));
+    QCOMPARE(recording.size(), frames);
+    QVERIFY(recording.frame(0).m_multiView);
+
+    QCOMPARE(m_room->ReplayRays(recording, runs), size_t(0));
+}
+
+void RayReplayTest::otherModeIsNotCompared()
+{
+    QString fileName = m_directory.filePath("other.rays");
+    QVERIFY(record(false, fileName));
+
+    RayRecording recording;
+    QVERIFY(recording.load(fileName));
+
+    //pairwise points are not expected from multi-view triangulation, runs still have to agree
+    m_room->setMultiView(true);
+    QCOMPARE(m_room->ReplayRays(recording, runs), size_t(0));
+}
+
+QTEST_MAIN(RayReplayTest)
+
+#include "rayreplaytest.moc"
@@ -0,0 +1,18 @@
+#-------------------------------------------------
+#
+# Rays of synthetic scene replayed through triangulation,
+# run with make check, QT_QPA_PLATFORM=offscreen without display
+#
+#-------------------------------------------------
+
+include(../webcamcap.pri)
+
+TARGET = rayreplaytest
+TEMPLATE = app
+
+CONFIG += testcase
+
+UI_DIR += Gui
+UI_HEADERS_DIR += Gui
+
+SOURCES += rayreplaytest.cpp
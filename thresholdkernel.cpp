@@ -0,0 +1,281 @@
+/*
+ *
+ * Copyright (C) 2014  Miroslav Krajicek, Faculty of Informatics Masaryk University (https://github.com/kaajo).
+ * All Rights Reserved.
+ *
+ * This file is part of WebCamCap.
+ *
+ * WebCamCap is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU LGPL version 3 as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WebCamCap is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU LGPL version 3
+ * along with WebCamCap. If not, see <http://www.gnu.org/licenses/lgpl-3.0.txt>.
+ *
+ */
+
+#include "thresholdkernel.h"
+
+#include <cstdlib>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define THRESHOLD_KERNEL_SSSE3
+#define THRESHOLD_KERNEL_AVX2
+#include <immintrin.h>
+#endif
+
+//cvtColor BGR2GRAY weights, 14 bit fixed point
+static const int grayB = 1868;
+static const int grayG = 9617;
+static const int grayR = 4899;
+static const int grayShift = 14;
+
+typedef void (*RowKernel)(const uchar *frame, const uchar *background, uchar *mask, int width, int diffThreshold, int threshold);
+
+static inline int gray(int b, int g, int r)
+{
+    return (b*grayB + g*grayG + r*grayR + (1 << (grayShift - 1))) >> grayShift;
+}
+
+static void rowScalar(const uchar *frame, const uchar *background, uchar *mask, int width, int diffThreshold, int threshold)
+{
+    for(int x = 0; x < width; x++, frame += 3, background += 3)
+    {
+        int diff = gray(std::abs(frame[0] - background[0]), std::abs(frame[1] - background[1]), std::abs(frame[2] - background[2]));
+
+        mask[x] = (diff > diffThreshold && gray(frame[0], frame[1], frame[2]) > threshold) ? 255 : 0;
+    }
+}
+
+#ifdef THRESHOLD_KERNEL_SSSE3
+
+//splits 16 BGR pixels into planes
+__attribute__((target("ssse3")))
+static inline void deinterleave(const uchar *bgr, __m128i &b, __m128i &g, __m128i &r)
+{
+    const __m128i v0 = _mm_loadu_si128((const __m128i*) bgr);
+    const __m128i v1 = _mm_loadu_si128((const __m128i*) (bgr + 16));
+    const __m128i v2 = _mm_loadu_si128((const __m128i*) (bgr + 32));
+
+    b = _mm_or_si128(_mm_or_si128(
+            _mm_shuffle_epi8(v0, _mm_setr_epi8(0, 3, 6, 9, 12, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1)),
+            _mm_shuffle_epi8(v1, _mm_setr_epi8(-1, -1, -1, -1, -1, -1, 2, 5, 8, 11, 14, -1, -1, -1, -1, -1))),
+            _mm_shuffle_epi8(v2, _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 1, 4, 7, 10, 13)));
+
+    g = _mm_or_si128(_mm_or_si128(
+            _mm_shuffle_epi8(v0, _mm_setr_epi8(1, 4, 7, 10, 13, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1)),
+            _mm_shuffle_epi8(v1, _mm_setr_epi8(-1, -1, -1, -1, -1, 0, 3, 6, 9, 12, 15, -1, -1, -1, -1, -1))),
+            _mm_shuffle_epi8(v2, _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 2, 5, 8, 11, 14)));
+
+    r = _mm_or_si128(_mm_or_si128(
+            _mm_shuffle_epi8(v0, _mm_setr_epi8(2, 5, 8, 11, 14, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1)),
+            _mm_shuffle_epi8(v1, _mm_setr_epi8(-1, -1, -1, -1, -1, 1, 4, 7, 10, 13, -1, -1, -1, -1, -1, -1))),
+            _mm_shuffle_epi8(v2, _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 0, 3, 6, 9, 12, 15)));
+}
+
+//gray of 8 pixels in 16 bit lanes, (b,g) and (r,1) pairs go through madd so rounding matches scalar
+__attribute__((target("ssse3")))
+static inline __m128i gray8(__m128i b, __m128i g, __m128i r)
+{
+    const __m128i weightsBG = _mm_setr_epi16(grayB, grayG, grayB, grayG, grayB, grayG, grayB, grayG);
+    const __m128i weightsR1 = _mm_setr_epi16(grayR, 1 << (grayShift - 1), grayR, 1 << (grayShift - 1), grayR, 1 << (grayShift - 1), grayR, 1 << (grayShift - 1));
+    const __m128i one = _mm_set1_epi16(1);
+
+    __m128i bgLo = _mm_madd_epi16(_mm_unpacklo_epi16(b, g), weightsBG);
+    __m128i bgHi = _mm_madd_epi16(_mm_unpackhi_epi16(b, g), weightsBG);
+    __m128i r1Lo = _mm_madd_epi16(_mm_unpacklo_epi16(r, one), weightsR1);
+    __m128i r1Hi = _mm_madd_epi16(_mm_unpackhi_epi16(r, one), weightsR1);
+
+    __m128i lo = _mm_srai_epi32(_mm_add_epi32(bgLo, r1Lo), grayShift);
+    __m128i hi = _mm_srai_epi32(_mm_add_epi32(bgHi, r1Hi), grayShift);
+
+    return _mm_packs_epi32(lo, hi);
+}
+
+//gray of 16 pixels
+__attribute__((target("ssse3")))
+static inline __m128i gray16(__m128i b, __m128i g, __m128i r)
+{
+    const __m128i zero = _mm_setzero_si128();
+
+    __m128i lo = gray8(_mm_unpacklo_epi8(b, zero), _mm_unpacklo_epi8(g, zero), _mm_unpacklo_epi8(r, zero));
+    __m128i hi = gray8(_mm_unpackhi_epi8(b, zero), _mm_unpackhi_epi8(g, zero), _mm_unpackhi_epi8(r, zero));
+
+    return _mm_packus_epi16(lo, hi);
+}
+
+__attribute__((target("ssse3")))
+static inline __m128i absDiff(__m128i a, __m128i b)
+{
+    return _mm_or_si128(_mm_subs_epu8(a, b), _mm_subs_epu8(b, a));
+}
+
+__attribute__((target("ssse3")))
+static void rowSSSE3(const uchar *frame, const uchar *background, uchar *mask, int width, int diffThreshold, int threshold)
+{
+    //x > t is max(x, t + 1) == x, thresholds are in -1..254
+    const __m128i diffLimit = _mm_set1_epi8((char) (diffThreshold + 1));
+    const __m128i limit = _mm_set1_epi8((char) (threshold + 1));
+
+    int x = 0;
+
+    for(; x + 16 <= width; x += 16)
+    {
+        __m128i fb, fg, fr, bb, bg, br;
+
+        deinterleave(frame + 3*x, fb, fg, fr);
+        deinterleave(background + 3*x, bb, bg, br);
+
+        __m128i diffGray = gray16(absDiff(fb, bb), absDiff(fg, bg), absDiff(fr, br));
+        __m128i frameGray = gray16(fb, fg, fr);
+
+        __m128i result = _mm_and_si128(_mm_cmpeq_epi8(_mm_max_epu8(diffGray, diffLimit), diffGray),
+                                       _mm_cmpeq_epi8(_mm_max_epu8(frameGray, limit), frameGray));
+
+        _mm_storeu_si128((__m128i*) (mask + x), result);
+    }
+
+    rowScalar(frame + 3*x, background + 3*x, mask + x, width - x, diffThreshold, threshold);
+}
+
+#endif
+
+#ifdef THRESHOLD_KERNEL_AVX2
+
+//gray of 16 pixels in 16 bit lanes, unpack and pack stay inside 128 bit halves so order is kept
+__attribute__((target("avx2")))
+static inline __m256i gray16x16(__m256i b, __m256i g, __m256i r)
+{
+    const __m256i weightsBG = _mm256_set1_epi32(grayB | (grayG << 16));
+    const __m256i weightsR1 = _mm256_set1_epi32(grayR | (1 << (grayShift - 1 + 16)));
+    const __m256i one = _mm256_set1_epi16(1);
+
+    __m256i bgLo = _mm256_madd_epi16(_mm256_unpacklo_epi16(b, g), weightsBG);
+    __m256i bgHi = _mm256_madd_epi16(_mm256_unpackhi_epi16(b, g), weightsBG);
+    __m256i r1Lo = _mm256_madd_epi16(_mm256_unpacklo_epi16(r, one), weightsR1);
+    __m256i r1Hi = _mm256_madd_epi16(_mm256_unpackhi_epi16(r, one), weightsR1);
+
+    __m256i lo = _mm256_srai_epi32(_mm256_add_epi32(bgLo, r1Lo), grayShift);
+    __m256i hi = _mm256_srai_epi32(_mm256_add_epi32(bgHi, r1Hi), grayShift);
+
+    return _mm256_packs_epi32(lo, hi);
+}
+
+//mask of 16 pixels in 16 bit lanes, gray levels fit signed compare
+__attribute__((target("avx2")))
+static inline __m256i mask16(const uchar *frame, const uchar *background, __m256i diffThreshold, __m256i threshold)
+{
+    __m128i fb, fg, fr, bb, bg, br;
+
+    deinterleave(frame, fb, fg, fr);
+    deinterleave(background, bb, bg, br);
+
+    __m256i b = _mm256_cvtepu8_epi16(fb), g = _mm256_cvtepu8_epi16(fg), r = _mm256_cvtepu8_epi16(fr);
+
+    __m256i diffGray = gray16x16(_mm256_abs_epi16(_mm256_sub_epi16(b, _mm256_cvtepu8_epi16(bb))),
+                                 _mm256_abs_epi16(_mm256_sub_epi16(g, _mm256_cvtepu8_epi16(bg))),
+                                 _mm256_abs_epi16(_mm256_sub_epi16(r, _mm256_cvtepu8_epi16(br))));
+    __m256i frameGray = gray16x16(b, g, r);
+
+    return _mm256_and_si256(_mm256_cmpgt_epi16(diffGray, diffThreshold), _mm256_cmpgt_epi16(frameGray, threshold));
+}
+
+__attribute__((target("avx2")))
+static void rowAVX2(const uchar *frame, const uchar *background, uchar *mask, int width, int diffThreshold, int threshold)
+{
+    const __m256i diffLimit = _mm256_set1_epi16(diffThreshold);
+    const __m256i limit = _mm256_set1_epi16(threshold);
+
+    int x = 0;
+
+    //shuffles of SSSE3 split pixels, gray and compare run on 16 pixels at once
+    for(; x + 32 <= width; x += 32)
+    {
+        __m256i lo = mask16(frame + 3*x, background + 3*x, diffLimit, limit);
+        __m256i hi = mask16(frame + 3*(x + 16), background + 3*(x + 16), diffLimit, limit);
+
+        //pack interleaves 128 bit halves, permute puts 64 bit quarters back in order
+        __m256i result = _mm256_permute4x64_epi64(_mm256_packs_epi16(lo, hi), 0xD8);
+
+        _mm256_storeu_si256((__m256i*) (mask + x), result);
+    }
+
+    rowSSSE3(frame + 3*x, background + 3*x, mask + x, width - x, diffThreshold, threshold);
+}
+
+#endif
+
+static RowKernel selectKernel()
+{
+#ifdef THRESHOLD_KERNEL_AVX2
+    if(__builtin_cpu_supports("avx2"))
+    {
+        return rowAVX2;
+    }
+#endif
+
+#ifdef THRESHOLD_KERNEL_SSSE3
+    if(__builtin_cpu_supports("ssse3"))
+    {
+        return rowSSSE3;
+    }
+#endif
+
+    return rowScalar;
+}
+
+static const RowKernel rowKernel = selectKernel();
+
+void backgroundThreshold(const cv::Mat &frame, const cv::Mat &background, cv::Mat &mask, int diffThreshold, int threshold)
+{
+    CV_Assert(frame.type() == CV_8UC3 && background.type() == CV_8UC3 && frame.size() == background.size());
+
+    mask.create(frame.size(), CV_8UC1);
+
+    //nothing is brighter than 255, thresholds have to fit 8 bit compare
+    if(threshold >= 255 || diffThreshold >= 255)
+    {
+        mask.setTo(cv::Scalar::all(0));
+        return;
+    }
+
+    if(threshold < 0)
+    {
+        threshold = -1;
+    }
+
+    if(diffThreshold < 0)
+    {
+        diffThreshold = -1;
+    }
+
+    for(int y = 0; y < frame.rows; y++)
+    {
+        rowKernel(frame.ptr<uchar>(y), background.ptr<uchar>(y), mask.ptr<uchar>(y), frame.cols, diffThreshold, threshold);
+    }
+}
+
+const char *backgroundThresholdKernel()
+{
+#ifdef THRESHOLD_KERNEL_AVX2
+    if(rowKernel == rowAVX2)
+    {
+        return "AVX2";
+    }
+#endif
+
+#ifdef THRESHOLD_KERNEL_SSSE3
+    if(rowKernel == rowSSSE3)
+    {
+        return "SSSE3";
+    }
+#endif
+
+    return "scalar";
+}
@@ -0,0 +1,46 @@
+/*
+ *
+ * Copyright (C) 2014  Miroslav Krajicek, Faculty of Informatics Masaryk University (https://github.com/kaajo).
+ * All Rights Reserved.
+ *
+ * This file is part of WebCamCap.
+ *
+ * WebCamCap is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU LGPL version 3 as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WebCamCap is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU LGPL version 3
+ * along with WebCamCap. If not, see <http://www.gnu.org/licenses/lgpl-3.0.txt>.
+ *
+ */
+
+#ifndef THRESHOLDKERNEL_H
+#define THRESHOLDKERNEL_H
+
+#include <opencv2/core/core.hpp>
+
+/// gray level of one BGR pixel, same as cvtColor BGR2GRAY
+inline int grayLevel(const uchar *bgr)
+{
+    return (bgr[0]*1868 + bgr[1]*9617 + bgr[2]*4899 + (1 << 13)) >> 14;
+}
+
+/**
+ * @brief one pass replacement of absdiff, gray threshold of difference, masked copy, gray and threshold
+ *
+ * mask = 255 where gray(|frame - background|) > diffThreshold and gray(frame) > threshold, 0 elsewhere.
+ * Gray uses the same fixed point weights as cvtColor, result is identical to the OpenCV chain.
+ * Thresholds are 0..255. Frames are 8UC3, mask is 8UC1 of the same size (can be a view into larger buffer).
+ */
+void backgroundThreshold(const cv::Mat &frame, const cv::Mat &background, cv::Mat &mask, int diffThreshold, int threshold);
+
+/// name of the kernel picked at runtime, for logs
+const char *backgroundThresholdKernel();
+
+#endif // THRESHOLDKERNEL_H
@@ -0,0 +1,253 @@
+/*
+ *
+ * Copyright (C) 2014  Miroslav Krajicek, Faculty of Informatics Masaryk University (https://github.com/kaajo).
+ * All Rights Reserved.
+ *
+ * This file is part of WebCamCap.
+ *
+ * WebCamCap is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU LGPL version 3 as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WebCamCap is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU LGPL version 3
+ * along with WebCamCap. If not, see <http://www.gnu.org/licenses/lgpl-3.0.txt>.
+ *
+ */
+
+#include "triangulator.h"
+
+#include <algorithm>
+#include <cmath>
+
+using glm::vec3;
+using glm::dvec3;
+
+void Triangulator::Correspondence::add(const Correspondence &other)
+{
+    for(int i = 0; i < 6; i++)
+    {
+        m_a[i] += other.m_a[i];
+    }
+
+    for(int i = 0; i < 3; i++)
+    {
+        m_b[i] += other.m_b[i];
+    }
+
+    m_c += other.m_c;
+    m_cameraMask |= other.m_cameraMask;
+    m_rays += other.m_rays;
+}
+
+bool Triangulator::Correspondence::solve(dvec3 &position, double &squaredResidual) const
+{
+    const double xx = m_a[0], xy = m_a[1], xz = m_a[2], yy = m_a[3], yz = m_a[4], zz = m_a[5];
+
+    //cofactors of symmetric matrix
+    double c00 = yy*zz - yz*yz;
+    double c01 = xz*yz - xy*zz;
+    double c02 = xy*yz - xz*yy;
+    double c11 = xx*zz - xz*xz;
+    double c12 = xy*xz - xx*yz;
+    double c22 = xx*yy - xy*xy;
+
+    double determinant = xx*c00 + xy*c01 + xz*c02;
+
+    //parallel rays, point is not defined
+    if(std::abs(determinant) < 1e-12 * m_rays * m_rays * m_rays)
+    {
+        return false;
+    }
+
+    position = dvec3(c00*m_b[0] + c01*m_b[1] + c02*m_b[2],
+                     c01*m_b[0] + c11*m_b[1] + c12*m_b[2],
+                     c02*m_b[0] + c12*m_b[1] + c22*m_b[2]) / determinant;
+
+    //sum of squared distances is c - b.p at the minimum
+    squaredResidual = std::max(0.0, m_c - (m_b[0]*position.x + m_b[1]*position.y + m_b[2]*position.z)) / m_rays;
+
+    return true;
+}
+
+Triangulator::Triangulator(float maxError, float epipolarTolerance)
+{
+    m_maxError = maxError;
+    m_epipolarTolerance = epipolarTolerance;
+}
+
+//same segment test as intersectRays, point may lie maxError outside of the part of ray inside room
+static inline bool onSegment(const Line &line, const vec3 &point, float maxError)
+{
+    float squaredLength = glm::dot(line.m_directionVector, line.m_directionVector);
+
+    if(squaredLength <= 0)
+    {
+        return true;
+    }
+
+    float t = glm::dot(point - line.m_position, line.m_directionVector) / squaredLength;
+    float slack = maxError / std::sqrt(squaredLength);
+
+    return t >= line.m_tmin - slack && t <= line.m_tmax + slack;
+}
+
+int Triangulator::find(int set)
+{
+    while(m_sets[set].m_parent != set)
+    {
+        m_sets[set].m_parent = m_sets[m_sets[set].m_parent].m_parent;
+        set = m_sets[set].m_parent;
+    }
+
+    return set;
+}
+
+void Triangulator::triangulate(const QVector<QVector<Line>> &rays, std::vector<TriangulatedPoint> &points)
+{
+    points.clear();
+    m_candidates.clear();
+    m_culledPairs = 0;
+    m_sets.clear();
+    m_offsets.assign(1, 0);
+
+    const int cameras = std::min(rays.size(), 64);
+
+    //every ray starts as correspondence of its own
+    for(int camera = 0; camera < cameras; camera++)
+    {
+        for(const Line &line: rays[camera])
+        {
+            dvec3 d = glm::normalize(dvec3(line.m_directionVector));
+            dvec3 o = dvec3(line.m_position);
+
+            //(I - d d^T) projects onto plane perpendicular to ray
+            Correspondence set;
+            set.m_a[0] = 1 - d.x*d.x; set.m_a[1] = -d.x*d.y; set.m_a[2] = -d.x*d.z;
+            set.m_a[3] = 1 - d.y*d.y; set.m_a[4] = -d.y*d.z; set.m_a[5] = 1 - d.z*d.z;
+
+            dvec3 perpendicular = o - d * glm::dot(d, o);
+            set.m_b[0] = perpendicular.x;
+            set.m_b[1] = perpendicular.y;
+            set.m_b[2] = perpendicular.z;
+            set.m_c = glm::dot(perpendicular, o);
+            set.m_cameraMask = uint64_t(1) << camera;
+            set.m_rays = 1;
+            set.m_parent = m_sets.size();
+
+            m_sets.push_back(set);
+        }
+
+        m_offsets.push_back(m_sets.size());
+    }
+
+    //consistent pairs of every two cameras, epipolar band limits tested pairs
+    EpipolarGeometry epipolar;
+    vec3 closest1, closest2;
+
+    for(int first = 0; first < cameras; first++)
+    {
+        for(int second = first + 1; second < cameras; second++)
+        {
+            if(rays[first].isEmpty() || rays[second].isEmpty())
+            {
+                continue;
+            }
+
+            epipolar.set(rays[first][0].m_position, rays[second][0].m_position, m_epipolarTolerance, m_maxError);
+
+            auto test = [&](int i, int j)
+            {
+                //parallel lines leave closest points untouched, distance of cameras rejects them
+                closest1 = rays[first][i].m_position;
+                closest2 = rays[second][j].m_position;
+
+                Line::ClosestPointsOnTwoLines(rays[first][i], rays[second][j], closest1, closest2);
+
+                float distance = Line::DistanceTwoPoints(closest1, closest2);
+
+                if(distance >= m_maxError)
+                {
+                    return;
+                }
+
+                //rays meeting behind a camera or outside of room
+                if(!onSegment(rays[first][i], closest1, m_maxError) || !onSegment(rays[second][j], closest2, m_maxError))
+                {
+                    ++m_culledPairs;
+                    return;
+                }
+
+                m_candidates.push_back({distance, m_offsets[first] + i, m_offsets[second] + j});
+            };
+
+            if(!epipolar.valid())
+            {
+                for(int i = 0; i < rays[first].size(); i++)
+                {
+                    for(int j = 0; j < rays[second].size(); j++)
+                    {
+                        test(i, j);
+                    }
+                }
+
+                continue;
+            }
+
+            epipolar.sortByAngle(rays[second], m_sorted);
+
+            for(int i = 0; i < rays[first].size(); i++)
+            {
+                epipolar.forCandidates(m_sorted, rays[first][i], [&](int j) {test(i, j);});
+            }
+        }
+    }
+
+    std::sort(m_candidates.begin(), m_candidates.end());
+
+    //pair criterion is distance below max error, mean squared distance from midpoint is (distance/2)^2
+    const double maxSquaredResidual = m_maxError * m_maxError / 4.0;
+
+    dvec3 position;
+    double squaredResidual;
+
+    for(const Candidate &candidate: m_candidates)
+    {
+        int a = find(candidate.m_rayA);
+        int b = find(candidate.m_rayB);
+
+        if(a == b || (m_sets[a].m_cameraMask & m_sets[b].m_cameraMask))
+        {
+            continue;
+        }
+
+        Correspondence merged = m_sets[a];
+        merged.add(m_sets[b]);
+
+        if(!merged.solve(position, squaredResidual) || squaredResidual > maxSquaredResidual)
+        {
+            continue;
+        }
+
+        merged.m_parent = a;
+        m_sets[a] = merged;
+        m_sets[b].m_parent = a;
+    }
+
+    for(size_t i = 0; i < m_sets.size(); i++)
+    {
+        const Correspondence &set = m_sets[i];
+
+        if(set.m_parent != (int) i || set.m_rays < 2 || (size_t) set.m_rays < m_minCameras || !set.solve(position, squaredResidual))
+        {
+            continue;
+        }
+
+        points.push_back({vec3(position), (float) std::sqrt(squaredResidual), (size_t) set.m_rays});
+    }
+}
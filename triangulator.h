@@ -0,0 +1,98 @@
+/*
+ *
+ * Copyright (C) 2014  Miroslav Krajicek, Faculty of Informatics Masaryk University (https://github.com/kaajo).
+ * All Rights Reserved.
+ *
+ * This file is part of WebCamCap.
+ *
+ * WebCamCap is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU LGPL version 3 as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WebCamCap is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU LGPL version 3
+ * along with WebCamCap. If not, see <http://www.gnu.org/licenses/lgpl-3.0.txt>.
+ *
+ */
+
+#ifndef TRIANGULATOR_H
+#define TRIANGULATOR_H
+
+#include "epipolargeometry.h"
+
+#include <cstdint>
+
+class TriangulatedPoint
+{
+public:
+    glm::vec3 m_position;
+    float m_residual;   /// root mean square distance of contributing rays from position
+    size_t m_cameras;   /// number of cameras (one ray each) the point was solved from
+};
+
+/**
+ * @brief one point per marker from rays of all cameras
+ *
+ * Ray pairs of every two cameras closer than max error and meeting on the parts of rays inside room are candidates.
+ * They are merged from the closest one into correspondence sets with at most one ray per camera,
+ * while least squares point of the set stays consistent.
+ * Normal equations of set are summed, so merge and solve are constant time.
+ */
+class Triangulator
+{
+    class Candidate
+    {
+    public:
+        float m_distance;
+        int m_rayA, m_rayB;
+
+        bool operator<(const Candidate &other) const {return m_distance < other.m_distance;}
+    };
+
+    //sum of (I - d d^T) over rays, right side and constant term of squared distance
+    class Correspondence
+    {
+    public:
+        double m_a[6];  /// symmetric, xx xy xz yy yz zz
+        double m_b[3];
+        double m_c;
+        uint64_t m_cameraMask;
+        int m_rays;
+        int m_parent;
+
+        void add(const Correspondence &other);
+        bool solve(glm::dvec3 &position, double &squaredResidual) const;
+    };
+
+    float m_maxError;
+    float m_epipolarTolerance;
+    size_t m_minCameras = 2;
+    size_t m_culledPairs = 0;
+
+    std::vector<int> m_offsets;
+    std::vector<Candidate> m_candidates;
+    std::vector<Correspondence> m_sets;
+    std::vector<std::pair<float, int>> m_sorted;
+
+    int find(int set);
+
+public:
+    Triangulator(float maxError = 0.5f, float epipolarTolerance = 2.0f);
+
+    void setMaxError(float maxError) {m_maxError = maxError;}
+    void setEpipolarTolerance(float degrees) {m_epipolarTolerance = degrees;}
+    void setMinCameras(size_t cameras) {m_minCameras = cameras;}
+    size_t minCameras() const {return m_minCameras;}
+    /// close pairs of last triangulate meeting outside of segments of rays inside room
+    size_t culledPairs() const {return m_culledPairs;}
+
+    /// rays[i] are lines of camera i, at most 64 cameras are used
+    void triangulate(const QVector<QVector<Line>> &rays, std::vector<TriangulatedPoint> &points);
+};
+
+#endif // TRIANGULATOR_H
@@ -0,0 +1,105 @@
+# sources shared by application and tests, paths are relative to this file
+
+QT += core gui opengl testlib concurrent network
+
+LIBS += -lglut
+
+greaterThan(QT_MAJOR_VERSION, 5): QT += widgets
+
+CONFIG += link_pkgconfig
+
+PKGCONFIG += opencv gl glu
+
+INCLUDEPATH += $$PWD $$PWD/Gui
+
+SOURCES += \
+    $$PWD/capturecamera.cpp \
+    $$PWD/line.cpp \
+    $$PWD/markerpoint.cpp \
+    $$PWD/modelstructure.cpp \
+    $$PWD/openglwindow.cpp \
+    $$PWD/animation.cpp \
+    $$PWD/frame.cpp \
+    $$PWD/Gui/structureeditor.cpp \
+    $$PWD/Gui/addproject.cpp \
+    $$PWD/Gui/mainwindow.cpp \
+    $$PWD/Gui/animplayer.cpp \
+    $$PWD/room.cpp \
+    $$PWD/capturethread.cpp \
+    $$PWD/Gui/camwidget.cpp \
+    $$PWD/Gui/addcamera.cpp \
+    $$PWD/pointchecker.cpp \
+    $$PWD/framesource.cpp \
+    $$PWD/syntheticscene.cpp \
+    $$PWD/grabthread.cpp \
+    $$PWD/frameassembler.cpp \
+    $$PWD/blobtracker.cpp \
+    $$PWD/thresholdkernel.cpp \
+    $$PWD/blobextractor.cpp \
+    $$PWD/componentlabels.cpp \
+    $$PWD/runlengthdetector.cpp \
+    $$PWD/backgroundmodel.cpp \
+    $$PWD/pixelraytable.cpp \
+    $$PWD/cameracache.cpp \
+    $$PWD/epipolargeometry.cpp \
+    $$PWD/triangulator.cpp \
+    $$PWD/pointwelder.cpp \
+    $$PWD/raybatch.cpp \
+    $$PWD/rayrecording.cpp \
+    $$PWD/cameratopology.cpp \
+    $$PWD/fusionthread.cpp \
+    $$PWD/benchmark.cpp \
+    $$PWD/allocationcounter.cpp
+
+HEADERS += \
+    $$PWD/capturecamera.h \
+    $$PWD/line.h \
+    $$PWD/markerpoint.h \
+    $$PWD/modelstructure.h \
+    $$PWD/openglwindow.h \
+    $$PWD/animation.h \
+    $$PWD/frame.h \
+    $$PWD/Gui/structureeditor.h \
+    $$PWD/Gui/addproject.h \
+    $$PWD/Gui/mainwindow.h \
+    $$PWD/Gui/animplayer.h \
+    $$PWD/room.h \
+    $$PWD/capturethread.h \
+    $$PWD/Gui/camwidget.h \
+    $$PWD/Gui/addcamera.h \
+    $$PWD/pointchecker.h \
+    $$PWD/framesource.h \
+    $$PWD/syntheticscene.h \
+    $$PWD/grabthread.h \
+    $$PWD/frameassembler.h \
+    $$PWD/blobtracker.h \
+    $$PWD/thresholdkernel.h \
+    $$PWD/blobextractor.h \
+    $$PWD/componentlabels.h \
+    $$PWD/runlengthdetector.h \
+    $$PWD/backgroundmodel.h \
+    $$PWD/pixelraytable.h \
+    $$PWD/cameracache.h \
+    $$PWD/epipolargeometry.h \
+    $$PWD/triangulator.h \
+    $$PWD/pointwelder.h \
+    $$PWD/raybatch.h \
+    $$PWD/rayrecording.h \
+    $$PWD/cameratopology.h \
+    $$PWD/fusionthread.h \
+    $$PWD/spscqueue.h \
+    $$PWD/benchmark.h \
+    $$PWD/allocationcounter.h
+
+FORMS += \
+    $$PWD/Gui/structureeditor.ui \
+    $$PWD/Gui/mainwindow.ui \
+    $$PWD/Gui/animplayer.ui \
+    $$PWD/Gui/camwidget.ui \
+    $$PWD/Gui/addcamera.ui \
+    $$PWD/Gui/addproject.ui
+
+QMAKE_CXXFLAGS += -std=c++11 -pedantic -Wall -Wextra
+
+# qmake CONFIG+=count_allocations, capture cameras count heap allocations per frame
+count_allocations: DEFINES += WEBCAMCAP_COUNT_ALLOCATIONS